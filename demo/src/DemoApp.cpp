@@ -175,16 +175,10 @@ bool LoadContext(const std::string &vendorName, unsigned int deviceId)
 {
     bool r = false;
 
-    ORP_HANDLE hImpls = rpGetApiImpls();
+    // only one vendor is needed, the other vendor INIs aren't read
+    ORP_HANDLE hImpls = rpGetApiImplsLazy();
     if (hImpls)
     {
-        int loadErrCount = rpGetNumApiImplLoadErrors(hImpls);
-        for (int i = 0; i < loadErrCount; i++)
-        {
-            S_RP1210ImplLoadErr *le = rpGetApiImplLoadError(hImpls, i);
-            std::cout << "****Failed to load Implementation: " << le->ImplName << ". Error = " << le->Error << " Description = " << le->Description << "****" << std::endl;
-        }
-        
         ORP_HANDLE hImpl = rpGetApiImplByName(hImpls, vendorName.c_str());
         if (hImpl)
         {
@@ -202,6 +196,8 @@ bool LoadContext(const std::string &vendorName, unsigned int deviceId)
 
             rpFreeHandle(hImpl);
         }
+        else if (rpGetLastError() != ORP_ERR_NO_ERROR)
+            std::cout << "Failed to load API implementation. Vendor Name: " << vendorName << " Error: " << rpGetLastErrorDesc() << std::endl;
         else
             std::cout << "Failed to find API implementation. Vendor Name: " << vendorName << std::endl;
 
@@ -195,6 +195,16 @@ CLINK OpenRP1210API const char *rpGetLastErrorDesc(void);
 /// This function will parse RP1210.ini and the vendor INI files for all vendors
 /// listed in RP1210.ini.
 /// 
+/// The result is cached for the process, later calls return a handle to the same
+/// information without reading the INI files again. The files are checked for changes
+/// at most once a second and read again when one of them has changed, or after
+/// rpRefreshApiImpls. Handles returned earlier keep the information they were created
+/// with. The information is shared between handles and threads, it must not be modified.
+/// 
+/// The information is also saved to openrp1210.cache in the RP1210 directory, so a new
+/// process can skip parsing while none of the INI files have changed since. Failing to
+/// write the cache isn't an error.
+/// 
 /// @return Returns NULL and sets LastError on failure or a valid handle on success. Even if a valid
 ///         handle is returned, it's still possible that there were errors parsing
 ///         INI files for specific vendors. Use rpGetNumApiImplLoadErrors to
@@ -202,6 +212,28 @@ CLINK OpenRP1210API const char *rpGetLastErrorDesc(void);
 /////////////////////////////////////////////////////////////////////////////////
 CLINK OpenRP1210API ORP_HANDLE rpGetApiImpls(void);
 
+/////////////////////////////////////////////////////////////////////////////////
+/// @brief Like rpGetApiImpls, but only reads the list of vendors from RP1210.ini.
+///
+/// A vendor INI file is parsed the first time rpGetApiImpl or rpGetApiImplByName
+/// returns its implementation, which suits callers that only use one vendor.
+/// rpGetNumApiImpls counts every listed vendor. Getting a vendor whose INI fails
+/// to load returns NULL and sets LastError, its error is then also returned by
+/// rpGetApiImplLoadError. The result is cached for the process like rpGetApiImpls,
+/// but not on disk.
+///
+/// @return Returns NULL and sets LastError on failure or a valid handle on success.
+/////////////////////////////////////////////////////////////////////////////////
+CLINK OpenRP1210API ORP_HANDLE rpGetApiImplsLazy(void);
+
+/////////////////////////////////////////////////////////////////////////////////
+/// @brief Discards the RP1210 information cached by rpGetApiImpls and rpGetApiImplsLazy.
+///
+/// The next call to rpGetApiImpls parses the INI files again, ignoring the on-disk
+/// cache, and rewrites the cache. Handles returned before the refresh stay valid.
+/////////////////////////////////////////////////////////////////////////////////
+CLINK OpenRP1210API void rpRefreshApiImpls(void);
+
 /////////////////////////////////////////////////////////////////////////////////
 /// @brief Gets a handle to an RP1210 API implementation by index.
 ///
@@ -380,6 +412,8 @@ CLINK OpenRP1210API int rpGetDeviceId(S_RP1210DeviceInformation *deviceInfo);
 /// @param[out] numDevices This will be set to the number of S_RP1210DeviceInformation in devices.
 /// @return Returns ORP_ERR_NO_ERROR on success.
 /// 
+/// Each device is listed once, in the order of the protocol's Devices key.
+/// 
 /// @note devices is managed the API and should not be freed by the caller.
 /////////////////////////////////////////////////////////////////////////////////
 CLINK OpenRP1210API ORP_ERR rpGetDevicesByProtocol(ORP_HANDLE hImpl, const char *protocol, S_RP1210DeviceInformation **devices, unsigned int *numDevices);
@@ -13,6 +13,7 @@ ORP_ERR rp_ClearLastError(void);
 
 ORP_ERR rp_SetLastError(ORP_ERR error, const char *msg, ...);
 ORP_ERR rp_SetLastErrorVA(ORP_ERR error, const char *msg, va_list *args);
+ORP_ERR rp_RestoreLastError(ORP_ERR error, const char *desc);
 
 void rp_AppendLastError(const char *msg, ...);
 
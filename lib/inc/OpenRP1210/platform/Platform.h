@@ -16,7 +16,37 @@ typedef enum E_SpecialDir_t
 	SD_SYS
 }E_SpecialDir;
 
+typedef struct S_FileInfo_t
+{
+	uint64_t Size;
+	int64_t ModifiedTime; // platform time stamp, only meaningful for comparing with another S_FileInfo
+	uint64_t Device;      // Device and Inode identify the file, e.g. volume serial and file index on Windows
+	uint64_t Inode;
+}S_FileInfo;
+
+typedef volatile long S_SpinLock; // 0 when unlocked, so it can be initialized statically
+
+typedef void (*THREAD_PROC)(void *userPtr);
+
 uint64_t rp_GetFileSize(const char* file);
+ORP_ERR rp_GetFileInfo(const char *file, S_FileInfo *info);
+ORP_ERR rp_ReplaceFile(const char *from, const char *to);
+unsigned long rp_GetProcessId(void);
+uint64_t rp_GetTickCount(void); // milliseconds since an arbitrary point, never goes backwards
+
+long rp_AtomicIncrement(volatile long *value);            // returns the new value
+long rp_AtomicDecrement(volatile long *value);            // returns the new value
+long rp_AtomicLoad(volatile long *value);                 // acquire
+void rp_AtomicStore(volatile long *value, long newValue); // release
+void *rp_AtomicLoadPointer(void *volatile *pointer);
+void rp_AtomicStorePointer(void *volatile *pointer, void *newValue);
+void rp_SpinLock(S_SpinLock *lock);
+void rp_SpinUnlock(S_SpinLock *lock);
+
+ORP_HANDLE rp_CreateThread(THREAD_PROC proc, void *userPtr); // freeing the handle waits for the thread to return
+unsigned int rp_GetProcessorCount(void);
+ORP_HANDLE rp_MapFile(const char *file);
+const void *rp_GetMappedFileData(ORP_HANDLE hMap, uint64_t *size);
 unsigned int rp_GetSpecialDir(E_SpecialDir directory, char *buf, unsigned int len);
 char rp_PathSeparator(void);
 
@@ -0,0 +1,31 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#ifndef OPENRP1210_ARENA_H__
+#define OPENRP1210_ARENA_H__
+
+#include "OpenRP1210/OpenRP1210.h"
+#include <stddef.h>
+
+struct S_ArenaBlock_t;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// A bump allocator. Memory is handed out from a list of large blocks and is
+/// only released all at once by rp_ArenaFree.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_Arena_t
+{
+	struct S_ArenaBlock_t *Blocks; // most recently allocated block first
+	size_t NextBlockSize;
+}S_Arena;
+
+void rp_ArenaInit(S_Arena *arena, size_t initialBlockSize);
+void rp_ArenaFree(S_Arena *arena);
+void rp_ArenaAdopt(S_Arena *arena, S_Arena *other); // moves every block of other into arena, other is left empty
+
+void *rp_ArenaAlloc(S_Arena *arena, size_t size);
+void *rp_ArenaAllocZ(S_Arena *arena, size_t size);
+
+#endif
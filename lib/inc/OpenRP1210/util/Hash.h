@@ -0,0 +1,17 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#ifndef OPENRP1210_HASH_H__
+#define OPENRP1210_HASH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+uint32_t rp_HashString(const char *str, size_t length, bool foldCase);
+uint32_t rp_HashFoldString(const char *str, size_t length, char *folded); // also writes the ASCII lower case form of str to folded
+uint32_t rp_HashTableSize(size_t count);
+
+#endif
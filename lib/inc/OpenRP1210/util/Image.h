@@ -0,0 +1,23 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#ifndef OPENRP1210_IMAGE_H__
+#define OPENRP1210_IMAGE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Binary images saved to disk and mapped back, like INI snapshots and the discovery cache.
+// An image is a fixed size header followed by a body of whole 32 bit words that's addressed by offsets.
+
+uint32_t rp_ImageBodyChecksum(const unsigned char *image, uint32_t headerSize, uint32_t imageSize);
+bool rp_ImageRange(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t imageSize); // word aligned array of count elements inside the image
+
+// Best effort, the image is written to a temporary file and renamed so readers never see a partial one.
+// Threads and processes saving the same path at once each write their own temporary file, the last rename wins.
+bool rp_SaveImage(const char *path, const unsigned char *image, uint32_t imageSize);
+
+#endif
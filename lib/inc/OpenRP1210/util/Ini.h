@@ -13,6 +13,11 @@
 
 typedef bool (*ENUM_KEYS_CALLBACK)(const char *key, const char *value, void *userPtr);
 
+// rp_IniParseStream callbacks, names and values are views into the file data and not NUL-terminated
+// return false to stop parsing
+typedef bool (*STREAM_SECTION_CALLBACK)(const char *section, size_t sectionLength, void *userPtr);
+typedef bool (*STREAM_KEY_CALLBACK)(const char *key, size_t keyLength, const char *value, size_t valueLength, void *userPtr);
+
 typedef enum E_IniDuplicateMode_t
 {
 	IniDuplicateMode_Ignore,
@@ -24,17 +29,46 @@ typedef struct S_IniConfig_t
 	E_IniDuplicateMode DuplicateMode;
 	bool TrimKeyValues;
 	bool KeysCaseInsensitive;
+	bool MemoryMapped;        // map the file read-only and keep symbols as views into the mapping
+	bool Snapshot;            // load a binary snapshot stored next to the INI when it's up to date, save one after parsing otherwise
+	bool VerifySnapshot;      // also checksum the whole snapshot on load, otherwise only its header and structure are checked
+	bool LazySections;        // only index section headers on open, the keys of a section are parsed the first time they are looked up
+	bool Shared;              // share one read-only INI per file and parse options across the process, see rp_IniOpen
+	bool BorrowBuffer;        // rp_IniOpenBuffer keeps views into the caller's memory instead of a copy, it must outlive the handle
 }S_IniConfig;
 
+S_IniConfig rp_CreateDefaultConfig(void);
+
+// With S_IniConfig::Shared every open of the same file, identified by device, inode, size and modification time,
+// gets its own handle to one INI that's parsed once and freed when the last handle is. Shared INIs aren't modified
+// by lookups, their handles may be read from any number of threads at once. S_IniConfig::LazySections is ignored.
 ORP_HANDLE rp_IniOpen(const char *iniPath, S_IniConfig *config);
 
+// Parses INI data already in memory, S_IniConfig::MemoryMapped, Snapshot and Shared need a file and are ignored
+ORP_HANDLE rp_IniOpenBuffer(const void *data, size_t length, S_IniConfig *config);
+
 bool rp_IniHasKey(ORP_HANDLE hIni, const char *section, const char *key);
 bool rp_IniHasSection(ORP_HANDLE hIni, const char *section);
 
 ORP_ERR rp_IniReadKey(ORP_HANDLE hIni, const char *section, const char *key, char *dest, size_t length);
 ORP_ERR rp_IniReadKeyLength(ORP_HANDLE hIni, const char *section, const char *key, size_t *length);
+
+// typed reads parse a value the first time and keep the result with the key, later reads of the same form don't parse or allocate
+// booleans are 1/0, true/false, yes/no or on/off in any case
+// lists are comma separated, spaces around items and empty items are skipped, the arrays are valid until the handle is freed
 ORP_ERR rp_IniReadInt(ORP_HANDLE hIni, const char *section, const char *key, int *value);
+ORP_ERR rp_IniReadBool(ORP_HANDLE hIni, const char *section, const char *key, bool *value);
+ORP_ERR rp_IniReadIntList(ORP_HANDLE hIni, const char *section, const char *key, const int **values, size_t *count);
+ORP_ERR rp_IniReadStringList(ORP_HANDLE hIni, const char *section, const char *key, const char *const **values, size_t *count);
+
+// value points into the INI's own storage, it's valid until the handle is freed and not NUL-terminated
+ORP_ERR rp_IniGetKeyView(ORP_HANDLE hIni, const char *section, const char *key, const char **value, size_t *length);
 
 ORP_ERR rp_IniEnumerateKeys(ORP_HANDLE hIni, const char *section, ENUM_KEYS_CALLBACK callback, void *userPtr);
 
+// Parses without building a symbol tree, every section and key is reported in file order, duplicates included
+// S_IniConfig::DuplicateMode and S_IniConfig::KeysCaseInsensitive are left to the callbacks
+ORP_ERR rp_IniParseStream(const char *iniPath, S_IniConfig *config, STREAM_SECTION_CALLBACK sectionCallback, STREAM_KEY_CALLBACK keyCallback, void *userPtr);
+bool rp_IniViewEquals(const char *view, size_t length, const char *s, bool caseSensitive);
+
 #endif
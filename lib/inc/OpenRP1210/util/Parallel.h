@@ -0,0 +1,21 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#ifndef OPENRP1210_PARALLEL_H__
+#define OPENRP1210_PARALLEL_H__
+
+typedef void (*PARALLEL_TASK)(void *userPtr, unsigned int index);
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Runs task once for every index in [0, count) and returns when all of them
+/// have finished. The calling thread works through the indexes together with up
+/// to maxThreads - 1 short-lived worker threads, in no particular order. If the
+/// workers can't be started the caller runs every index itself.
+///
+/// The last error is per thread, tasks must hand their results back through userPtr.
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ParallelFor(unsigned int count, unsigned int maxThreads, PARALLEL_TASK task, void *userPtr);
+
+#endif
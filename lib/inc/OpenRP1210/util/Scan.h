@@ -0,0 +1,18 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#ifndef OPENRP1210_SCAN_H__
+#define OPENRP1210_SCAN_H__
+
+#include <stddef.h>
+
+// Each function returns the offset of the first matching byte, or length if there is none.
+// "Printable" is the ASCII range 32-126.
+
+size_t rp_ScanToCharOrControl(const unsigned char *data, size_t length, unsigned char c); // c or a non-printable byte
+size_t rp_ScanToNewLine(const unsigned char *data, size_t length);                         // CR or LF
+size_t rp_ScanToNonSpace(const unsigned char *data, size_t length);                        // printable byte other than ' '
+
+#endif
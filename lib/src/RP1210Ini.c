@@ -7,6 +7,9 @@
 #include "OpenRP1210/Common.h"
 #include "OpenRP1210/platform/Platform.h"
 #include "OpenRP1210/util/Ini.h"
+#include "OpenRP1210/util/Hash.h"
+#include "OpenRP1210/util/Image.h"
+#include "OpenRP1210/util/Parallel.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -14,6 +17,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <stddef.h>
 
 #if defined _WIN32 || defined _WIN64
 	#define RP1210_HOME_DIR SD_OSHOME
@@ -36,13 +40,26 @@
 #endif
 
 #define MAX_RP1210_SECTION_NAME 50 // standards says name must be Device/ProtocolInformationXXXX, where X = device number
+#define MAX_RP1210_LIST_ITEM 32 // longest device or section number parsed out of a list
 
-#define READ_INI_VI_FIELD(ini, vi, name) \
-	vi->name = rp_ReadRP1210IniKey(ini, "VendorInformation", #name)
+#define DISCOVERY_CHECK_INTERVAL 1000 // ms, how often the INI files behind the cached discovery are checked for changes
 
-#define DEL_INI_FIELD(field, name) \
-	if(field->name) \
-		rp_free(field->name)
+#define DISCOVERY_MAX_THREADS 8 // vendor INIs are small, more threads only add startup cost
+
+#define DISCOVERY_CACHE_NAME "openrp1210.cache"
+#define DISCOVERY_CACHE_MAGIC 0x44505230u // "0RPD" in little endian byte order
+#define DISCOVERY_CACHE_VERSION 1
+#define DISCOVERY_CACHE_NULL UINT32_MAX   // string offset of a key that wasn't in the INI
+
+#define NUM_VENDOR_FIELDS (sizeof(S_RP1210VendorInformation) / sizeof(char *))
+#define NUM_DEVICE_FIELDS (sizeof(S_RP1210DeviceInformation) / sizeof(char *))
+#define NUM_PROTOCOL_FIELDS (sizeof(S_RP1210ProtocolInformation) / sizeof(char *))
+
+#define IMPL_ALIGNMENT 8
+#define IMPL_ALIGN(x) (((x) + (IMPL_ALIGNMENT - 1)) & ~((size_t)IMPL_ALIGNMENT - 1))
+
+#define READ_INI_VI_FIELD(ini, scan, name) \
+	rp_ReadIniView(ini, "VendorInformation", #name, &(scan)->Vendor[offsetof(S_RP1210VendorInformation, name) / sizeof(char *)])
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
@@ -56,6 +73,16 @@ typedef struct S_ProtocolDeviceMap_t
 	unsigned int NumDevices;
 }S_ProtocolDeviceMap;
 
+/////////////////////////////////////////////////////////////////////////////////
+/// Open addressed hash index over an array, built once and only read after that.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_LookupIndex_t
+{
+	uint32_t *Slots; // array index + 1, 0 for an empty slot
+	uint32_t Mask;
+}S_LookupIndex;
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -72,8 +99,77 @@ typedef struct S_RP1210ApiImpl_t
 
 	unsigned short NumDevices;
 	unsigned short NumProtocols;
+
+	S_LookupIndex DeviceNameIndex;  // Devices by DeviceName
+	S_LookupIndex DeviceIdIndex;    // Devices by DeviceIdValues
+	S_LookupIndex ProtocolIndex;    // Protocols by ProtocolString
+	unsigned int *DeviceIdValues;   // DeviceID of each device parsed once, only valid for devices in DeviceIdIndex
+
+	uint32_t *ProtocolDeviceBits;          // NumProtocols rows of DeviceBitWords, bit d set when device d supports the protocol
+	unsigned int DeviceBitWords;
+	unsigned int *ProtocolDeviceStart;     // NumProtocols + 1 offsets into ProtocolDevices
+	unsigned short *ProtocolDevices;       // device indexes of each protocol, in the order of its Devices key
+	unsigned int *DeviceProtocolStart;     // NumDevices + 1 offsets into DeviceProtocols
+	unsigned short *DeviceProtocols;       // protocol indexes of each device, in protocol order
 }S_RP1210ApiImpl;
 
+/////////////////////////////////////////////////////////////////////////////////
+/// What an implementation needs room for, see rp_LayoutApiImpl.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ApiImplSize_t
+{
+	unsigned int NumDevices;
+	unsigned int NumProtocols;
+	unsigned int NumDeviceIds; // over the device maps of all protocols
+	size_t StringsSize;        // every string of the implementation, terminators included
+}S_ApiImplSize;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Builds an implementation into a single allocation. The reader runs twice, first
+/// with Impl NULL to measure it, then again to fill the allocated block.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ApiImplBuilder_t
+{
+	S_ApiImplSize Size;
+	S_RP1210ApiImpl *Impl;   // NULL while measuring
+	char *Strings;           // next free byte of the string pool
+	unsigned int *DeviceIds; // next free entry of the device map pool
+}S_ApiImplBuilder;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// A value inside an open INI.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniView_t
+{
+	const char *Value; // NULL for a key that isn't in the INI
+	size_t Length;
+}S_IniView;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Everything rp_ScanApiImplIni found in a vendor INI, valid while the INI is open.
+/// Views are in the declaration order of the information struct they fill.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ApiImplScan_t
+{
+	S_IniView Vendor[NUM_VENDOR_FIELDS];
+	S_IniView *Devices;   // NUM_DEVICE_FIELDS per device
+	S_IniView *Protocols; // NUM_PROTOCOL_FIELDS per protocol
+	unsigned int NumDevices;
+	unsigned int NumProtocols;
+}S_ApiImplScan;
+
+static const char *const gDeviceKeys[NUM_DEVICE_FIELDS] =
+{
+	"DeviceId", "DeviceDescription", "DeviceName", "DeviceParams", "MultiCANChannels", "MultiJ1939Channels", "MultiISO15765Channels"
+};
+
+static const char *const gProtocolKeys[NUM_PROTOCOL_FIELDS] =
+{
+	"ProtocolDescription", "ProtocolSpeed", "ProtocolString", "ProtocolParams", "Devices"
+};
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -87,11 +183,174 @@ typedef struct S_RP1210ApiImpls_t
 	unsigned short NumLoadErrors;
 }S_RP1210ApiImpls;
 
+/////////////////////////////////////////////////////////////////////////////////
+/// An INI file read during discovery and its identity at the time it was read.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryFile_t
+{
+	char *Path;
+	S_FileInfo Info; // all zero if the file didn't exist
+}S_DiscoveryFile;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// An implementation of a lazy discovery, see rp_LoadLazyImpl.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_LazyImpl_t
+{
+	char *Name;
+	S_RP1210ImplLoadErr *LoadError; // set instead of the implementation when its INI failed to load
+	volatile long Loaded;           // once set the implementation, LoadError and file never change
+}S_LazyImpl;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// The result of reading rp121032.ini and every vendor INI it lists. It's never
+/// modified once built and is shared by every handle rpGetApiImpls returns,
+/// releasing the last reference frees it.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_Discovery_t
+{
+	S_RP1210ApiImpls Impls; // first member, rpGetApiImpls handles target the discovery itself
+	volatile long RefCount; // one per handle, plus one while it's the cached discovery
+	volatile long CheckedTime;
+
+	S_DiscoveryFile *Files; // rp121032.ini, then one per listed implementation
+	unsigned int NumFiles;
+
+	S_LazyImpl *LazyImpls; // set for rpGetApiImplsLazy, one per listed implementation and Impls slot
+	S_SpinLock LoadLock;   // guards the load errors of a lazy discovery
+	S_LookupIndex ImplIndex; // implementations by name, see rp_DiscoveryImplName
+}S_Discovery;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// One vendor INI read by rp_LoadImplTask.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ImplLoad_t
+{
+	const char *Name;
+	S_DiscoveryFile *File;
+	S_RP1210ApiImpl *Impl;
+	S_RP1210ImplLoadErr *LoadError;
+	ORP_ERR Error;   // set when the worker could produce neither Impl nor LoadError
+	char *ErrorDesc; // the worker's description of Error
+}S_ImplLoad;
+
+static S_SpinLock gDiscoveryLock;
+static S_Discovery *gDiscovery; // guarded by gDiscoveryLock
+static S_Discovery *gLazyDiscovery; // guarded by gDiscoveryLock
+static volatile long gDiscoveryCacheStale; // set by rpRefreshApiImpls, the next discovery reads the INI files
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Binary image of a discovery, see rp_SaveDiscoveryCache.
+/// All offsets are from the start of the image, string offsets are from Strings.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryCacheHeader_t
+{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t HeaderSize;
+	uint32_t ImageSize;
+	uint32_t Layout;        // rp_DiscoveryCacheLayout, the information structures depend on RP1210_VERSION
+
+	uint32_t Files;         // S_DiscoveryCacheFile[NumFiles], rp121032.ini first
+	uint32_t NumFiles;
+	uint32_t Impls;         // S_DiscoveryCacheImpl[NumImpls]
+	uint32_t NumImpls;
+	uint32_t Devices;       // S_DiscoveryCacheDevice[NumDevices], each implementation's devices are consecutive
+	uint32_t NumDevices;
+	uint32_t Protocols;     // S_DiscoveryCacheProtocol[NumProtocols], same for protocols
+	uint32_t NumProtocols;
+	uint32_t DeviceIds;     // uint32_t[NumDeviceIds], the protocol device maps
+	uint32_t NumDeviceIds;
+	uint32_t LoadErrors;    // S_DiscoveryCacheLoadErr[NumLoadErrors]
+	uint32_t NumLoadErrors;
+	uint32_t Strings;
+	uint32_t StringsSize;
+
+	uint32_t BodyChecksum;  // of everything after the header
+	uint32_t Checksum;      // of the header fields above
+}S_DiscoveryCacheHeader;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// An S_DiscoveryFile, the cache is only used while every file still matches.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryCacheFile_t
+{
+	uint64_t Size;
+	int64_t ModifiedTime;
+	uint64_t Device;
+	uint64_t Inode;
+	uint32_t Path;
+	uint32_t Reserved;
+}S_DiscoveryCacheFile;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryCacheImpl_t
+{
+	uint32_t Name;
+	uint32_t DriverPath;
+	uint32_t Vendor[NUM_VENDOR_FIELDS]; // S_RP1210VendorInformation fields in declaration order
+	uint32_t FirstDevice;
+	uint32_t NumDevices;
+	uint32_t FirstProtocol;
+	uint32_t NumProtocols;
+}S_DiscoveryCacheImpl;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryCacheDevice_t
+{
+	uint32_t Fields[NUM_DEVICE_FIELDS];
+}S_DiscoveryCacheDevice;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_DiscoveryCacheProtocol_t
+{
+	uint32_t Fields[NUM_PROTOCOL_FIELDS];
+	uint32_t ProtocolId;
+	uint32_t FirstDeviceId;
+	uint32_t NumDeviceIds;
+}S_DiscoveryCacheProtocol;
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-typedef void (*EnumIniSectionCallback)(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, unsigned int sectionIndex, const char *iniSectionName);
+typedef struct S_DiscoveryCacheLoadErr_t
+{
+	uint32_t ImplName;
+	uint32_t Description;
+	int32_t Error;
+}S_DiscoveryCacheLoadErr;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ParseNumber(const char *str, long *value)
+{
+	// a whole number in any base strtol reads, with optional spaces around it
+	char *e = NULL;
+
+	errno = 0; // strtol only sets it on failure, a stale value would reject a valid 0
+	*value = strtol(str, &e, 0);
+
+	while(*e == ' ' || *e == '\t')
+		e++;
+
+	return e != str && *e == 0 && errno == 0;
+}
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
@@ -101,20 +360,74 @@ long rp_strtol(const char *str)
 {
 	rp_ClearLastError();
 
-	char *e = NULL;
-	long l = strtol(str, &e, 0);
+	long l = 0;
 
-	if(l == 0)
-	{
-		if(errno != 0)
-			rp_SetLastError(ORP_ERR_BAD_ARG, NULL);
-	}
-	else if(e == NULL)
+	if(!rp_ParseNumber(str, &l))
 		rp_SetLastError(ORP_ERR_BAD_ARG, NULL);
 
 	return l;
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ParseDeviceId(const char *str, unsigned int *id)
+{
+	// accepts what rp_strtol accepts, without going through the last error
+	long l = 0;
+	bool valid = rp_ParseNumber(str, &l);
+
+	*id = (unsigned int)l;
+	return valid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_HashName(const char *name)
+{
+	return rp_HashString(name, strlen(name), false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_HashId(unsigned int id)
+{
+	return (uint32_t)id * 2654435761u;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_CreateLookupIndex(S_LookupIndex *index, unsigned int count)
+{
+	index->Mask = rp_HashTableSize(count) - 1;
+	index->Slots = rp_mallocZ((index->Mask + 1) * sizeof(uint32_t));
+
+	return index->Slots != NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AddLookupEntry(S_LookupIndex *index, uint32_t hash, unsigned int entry)
+{
+	// entries with equal keys stay in the order they were added along the probe sequence,
+	// so a lookup finds the first one first like the linear scans did
+	uint32_t i = hash & index->Mask;
+
+	while(index->Slots[i])
+		i = (i + 1) & index->Mask;
+
+	index->Slots[i] = entry + 1;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -230,7 +543,77 @@ static inline void rp_InitApiImpls(S_RP1210ApiImpls *impls, S_RP1210ApiImpl **im
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-ORP_ERR rp_ReadRP1210Ini(char **implsStr)
+typedef struct S_ImplsKeyReader_t
+{
+	bool CaseSensitive;
+	bool InSection;
+	bool SectionFound;
+	char *Value;
+}S_ImplsKeyReader;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static bool rp_ImplsKeyReaderSection(const char *section, size_t sectionLength, void *userPtr)
+{
+	// duplicates are ignored, so only the first [RP1210Support] counts and there's nothing left to read once it ends
+	S_ImplsKeyReader *reader = userPtr;
+	bool more = !reader->InSection;
+
+	reader->InSection = !reader->SectionFound && rp_IniViewEquals(section, sectionLength, "RP1210Support", reader->CaseSensitive);
+	reader->SectionFound |= reader->InSection;
+
+	return more;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static bool rp_ImplsKeyReaderKey(const char *key, size_t keyLength, const char *value, size_t valueLength, void *userPtr)
+{
+	S_ImplsKeyReader *reader = userPtr;
+	bool more = true;
+
+	if(reader->InSection && rp_IniViewEquals(key, keyLength, "APIImplementations", reader->CaseSensitive))
+	{
+		// the value is a view into the file, copy it before the file is closed
+		reader->Value = rp_malloc(valueLength + 1);
+		if(reader->Value)
+		{
+			memcpy(reader->Value, value, valueLength);
+			reader->Value[valueLength] = 0;
+		}
+		else
+			rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+		more = false;
+	}
+
+	return more;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_StatDiscoveryFile(S_DiscoveryFile *file)
+{
+	// called before the file is read, so a change made while it's read still shows up later.
+	// A missing file is recorded as all zero, it being created later is a change too
+	if(rp_GetFileInfo(file->Path, &file->Info) != ORP_ERR_NO_ERROR)
+	{
+		memset(&file->Info, 0, sizeof(S_FileInfo));
+		rp_ClearLastError();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ReadRP1210Ini(char **implsStr, S_DiscoveryFile *file)
 {
 	rp_SetLastError(ORP_ERR_NO_ERROR, NULL);
 
@@ -239,28 +622,25 @@ ORP_ERR rp_ReadRP1210Ini(char **implsStr)
 
 	if(!ORP_IS_ERR(r))
 	{
-		ORP_HANDLE rp1210Ini = rp_IniOpen(rp1210IniPath, NULL);
-		if(rp1210Ini)
-		{
-			size_t len = 0;
-			if((r = rp_IniReadKeyLength(rp1210Ini, "RP1210Support", "APIImplementations", &len)) == ORP_ERR_NO_ERROR)
-			{
-				*implsStr = rp_malloc(len + 1);
-				if(*implsStr)
-				{
-					if((r = rp_IniReadKey(rp1210Ini, "RP1210Support", "APIImplementations", *implsStr, len + 1)) != ORP_ERR_NO_ERROR)
-						rp_free(*implsStr);
-				}
-				else
-					r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
-			}
+		// only one key is needed, stream the file instead of building a symbol tree and stop once the key is read
+		S_IniConfig config = rp_CreateDefaultConfig();
+		config.MemoryMapped = true;
 
-			rpFreeHandle(rp1210Ini);
-		}
-		else
-			r = rpGetLastError();
+		S_ImplsKeyReader reader = { 0 };
+		reader.CaseSensitive = !config.KeysCaseInsensitive;
+
+		file->Path = rp1210IniPath; // kept to check the file for changes later
+		rp_StatDiscoveryFile(file);
 
-		rp_free(rp1210IniPath);
+		if((r = rp_IniParseStream(rp1210IniPath, &config, rp_ImplsKeyReaderSection, rp_ImplsKeyReaderKey, &reader)) == ORP_ERR_NO_ERROR)
+		{
+			if(reader.Value)
+				*implsStr = reader.Value;
+			else if(!reader.SectionFound)
+				r = rp_SetLastError(ORP_ERR_INI_SECTION_NOT_FOUND, " Section name = %s.", "RP1210Support");
+			else
+				r = rp_SetLastError(ORP_ERR_INI_KEYNOTFOUND, " Section name = %s, Key name = %s.", "RP1210Support", "APIImplementations");
+		}
 	}
 	else
 		rp_SetLastError(r, " Failed to find %s", RP1210_ININAME);
@@ -296,23 +676,20 @@ unsigned short rp_GetRP1210ImplMax(const char *rp1210ImplStr, const char *delim)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-char *rp_ReadRP1210IniKey(ORP_HANDLE ini, const char *section, const char *key)
+char *rp_ImplAddString(S_ApiImplBuilder *builder, const char *value, size_t length)
 {
 	char *v = NULL;
-	size_t keyLength = 0;
 
-	if(rp_IniReadKeyLength(ini, section, key, &keyLength) == ORP_ERR_NO_ERROR)
+	if(value && builder->Impl)
 	{
-		v = rp_malloc(keyLength + 1);
-		if(v)
-		{
-			if(rp_IniReadKey(ini, section, key, v, keyLength + 1) != ORP_ERR_NO_ERROR)
-			{
-				rp_free(v);
-				v = NULL;
-			}
-		}
+		v = builder->Strings;
+		memcpy(v, value, length);
+		v[length] = 0;
+
+		builder->Strings += length + 1;
 	}
+	else if(value)
+		builder->Size.StringsSize += length + 1;
 
 	return v;
 }
@@ -321,172 +698,233 @@ char *rp_ReadRP1210IniKey(ORP_HANDLE ini, const char *section, const char *key)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyVendorInformation(S_RP1210VendorInformation *vi)
+void *rp_CarveApiImpl(unsigned char *block, size_t *used, size_t size)
 {
-	DEL_INI_FIELD(vi, Name);
-	DEL_INI_FIELD(vi, Address1);
-	DEL_INI_FIELD(vi, Address2);
-	DEL_INI_FIELD(vi, City);
-	DEL_INI_FIELD(vi, State);
-	DEL_INI_FIELD(vi, Country);
-	DEL_INI_FIELD(vi, Postal);
-	DEL_INI_FIELD(vi, Telephone);
-	DEL_INI_FIELD(vi, Fax);
-	DEL_INI_FIELD(vi, VendorURL);
-	DEL_INI_FIELD(vi, MessageString);
-	DEL_INI_FIELD(vi, ErrorString);
-	DEL_INI_FIELD(vi, TimestampWeight);
-	DEL_INI_FIELD(vi, Devices);
-	DEL_INI_FIELD(vi, Protocols);
+	size_t offset = IMPL_ALIGN(*used);
+	*used = offset + size;
 
-	#if RP1210_VERSION >= RP1210_VERSION_B
-		DEL_INI_FIELD(vi, AutoDetectCapable);
-		DEL_INI_FIELD(vi, Version);
-		DEL_INI_FIELD(vi, RP1210);
-		DEL_INI_FIELD(vi, DebugLevel);
-		DEL_INI_FIELD(vi, DebugFile);
-		DEL_INI_FIELD(vi, DebugMode);
-		DEL_INI_FIELD(vi, DebugFileSize);
-		DEL_INI_FIELD(vi, NumberOfRTSCTSSessions);
-	#endif
-	#if RP1210_VERSION >= RP1210_VERSION_C
-		DEL_INI_FIELD(vi, CANFormatsSupported);
-		DEL_INI_FIELD(vi, J1939FormatsSupported);
-		DEL_INI_FIELD(vi, J1939Addresses);
-		DEL_INI_FIELD(vi, CANAutoBaud);
-		DEL_INI_FIELD(vi, J1708FormatsSupported);
-		DEL_INI_FIELD(vi, ISO15765FormatsSupported);
-	#endif
+	return block ? block + offset : NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyDeviceInformation(S_RP1210DeviceInformation *di)
+size_t rp_LayoutApiImpl(S_ApiImplBuilder *builder)
 {
-	DEL_INI_FIELD(di, DeviceID);
-	DEL_INI_FIELD(di, DeviceDescription);
-	DEL_INI_FIELD(di, DeviceName);
-	DEL_INI_FIELD(di, DeviceParams);
-	DEL_INI_FIELD(di, MultiCANChannels);
-	DEL_INI_FIELD(di, MultiJ1939Channels);
-	DEL_INI_FIELD(di, MultiISO15765Channels);
+	// computes the block size while builder->Impl is NULL, otherwise points every array of the
+	// zeroed block at its place. Each pool gets a spare entry so none of them is empty
+	const S_ApiImplSize *size = &builder->Size;
+	unsigned char *block = (unsigned char *)builder->Impl;
+	size_t used = sizeof(S_RP1210ApiImpl);
+
+	unsigned int deviceBitWords = (size->NumDevices + 31) / 32;
+	uint32_t deviceSlots = rp_HashTableSize(size->NumDevices);
+	uint32_t protocolSlots = rp_HashTableSize(size->NumProtocols);
+
+	S_RP1210DeviceInformation **devices = rp_CarveApiImpl(block, &used, size->NumDevices * sizeof(S_RP1210DeviceInformation *));
+	S_RP1210ProtocolInformation **protocols = rp_CarveApiImpl(block, &used, size->NumProtocols * sizeof(S_RP1210ProtocolInformation *));
+	S_ProtocolDeviceMap **maps = rp_CarveApiImpl(block, &used, size->NumProtocols * sizeof(S_ProtocolDeviceMap *));
+	S_RP1210DeviceInformation *deviceInfos = rp_CarveApiImpl(block, &used, size->NumDevices * sizeof(S_RP1210DeviceInformation));
+	S_RP1210ProtocolInformation *protocolInfos = rp_CarveApiImpl(block, &used, size->NumProtocols * sizeof(S_RP1210ProtocolInformation));
+	S_ProtocolDeviceMap *mapInfos = rp_CarveApiImpl(block, &used, size->NumProtocols * sizeof(S_ProtocolDeviceMap));
+	unsigned int *deviceIds = rp_CarveApiImpl(block, &used, (size->NumDeviceIds + 1) * sizeof(unsigned int));
+
+	uint32_t *deviceNameSlots = rp_CarveApiImpl(block, &used, deviceSlots * sizeof(uint32_t));
+	uint32_t *deviceIdSlots = rp_CarveApiImpl(block, &used, deviceSlots * sizeof(uint32_t));
+	uint32_t *protocolSlotsArray = rp_CarveApiImpl(block, &used, protocolSlots * sizeof(uint32_t));
+	unsigned int *deviceIdValues = rp_CarveApiImpl(block, &used, (size->NumDevices + 1) * sizeof(unsigned int));
+
+	uint32_t *protocolDeviceBits = rp_CarveApiImpl(block, &used, (size->NumProtocols * deviceBitWords + 1) * sizeof(uint32_t));
+	unsigned int *protocolDeviceStart = rp_CarveApiImpl(block, &used, (size->NumProtocols + 1) * sizeof(unsigned int));
+	unsigned int *deviceProtocolStart = rp_CarveApiImpl(block, &used, (size->NumDevices + 2) * sizeof(unsigned int));
+	unsigned short *protocolDevices = rp_CarveApiImpl(block, &used, (size->NumDeviceIds + 1) * sizeof(unsigned short));
+	unsigned short *deviceProtocols = rp_CarveApiImpl(block, &used, (size->NumDeviceIds + 1) * sizeof(unsigned short));
+
+	char *strings = rp_CarveApiImpl(block, &used, size->StringsSize + 1);
+
+	if(block)
+	{
+		S_RP1210ApiImpl *impl = builder->Impl;
+
+		impl->Devices = devices;
+		impl->Protocols = protocols;
+		impl->ProtocolDeviceMap = maps;
+		impl->NumDevices = (unsigned short)size->NumDevices;
+		impl->NumProtocols = (unsigned short)size->NumProtocols;
+
+		for(unsigned int i = 0; i < size->NumDevices; i++)
+			devices[i] = &deviceInfos[i];
+
+		for(unsigned int i = 0; i < size->NumProtocols; i++)
+		{
+			protocols[i] = &protocolInfos[i];
+			maps[i] = &mapInfos[i];
+			maps[i]->Protocol = protocols[i];
+			maps[i]->ProtocolId = i;
+		}
+
+		impl->DeviceNameIndex.Slots = deviceNameSlots;
+		impl->DeviceNameIndex.Mask = deviceSlots - 1;
+		impl->DeviceIdIndex.Slots = deviceIdSlots;
+		impl->DeviceIdIndex.Mask = deviceSlots - 1;
+		impl->ProtocolIndex.Slots = protocolSlotsArray;
+		impl->ProtocolIndex.Mask = protocolSlots - 1;
+		impl->DeviceIdValues = deviceIdValues;
+
+		impl->ProtocolDeviceBits = protocolDeviceBits;
+		impl->DeviceBitWords = deviceBitWords;
+		impl->ProtocolDeviceStart = protocolDeviceStart;
+		impl->DeviceProtocolStart = deviceProtocolStart;
+		impl->ProtocolDevices = protocolDevices;
+		impl->DeviceProtocols = deviceProtocols;
+
+		builder->Strings = strings;
+		builder->DeviceIds = deviceIds;
+	}
+
+	return used;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyProtocolInformation(S_RP1210ProtocolInformation *pi)
+bool rp_CreateApiImpl(S_ApiImplBuilder *builder)
 {
-	DEL_INI_FIELD(pi, ProtocolDescription);
-	DEL_INI_FIELD(pi, ProtocolSpeed);
-	DEL_INI_FIELD(pi, ProtocolString);
-	DEL_INI_FIELD(pi, ProtocolParams);
-	DEL_INI_FIELD(pi, Devices);
+	builder->Impl = NULL;
+	builder->Impl = rp_mallocZ(rp_LayoutApiImpl(builder));
+
+	if(builder->Impl)
+		rp_LayoutApiImpl(builder);
+
+	return builder->Impl != NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyProtocolDeviceMap(S_ProtocolDeviceMap *dm)
+void rp_DestroyApiImpl(S_RP1210ApiImpl *impl)
 {
-	if(dm->DeviceIds)
-		rp_free(dm->DeviceIds);
+	// strings, tables and indexes all live in the block rp_CreateApiImpl allocated
+	rp_free(impl);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyApiImpl(S_RP1210ApiImpl *impl)
+void rp_DestroyLoaderError(S_RP1210ImplLoadErr *e)
 {
-	rp_DestroyVendorInformation(&impl->VendorInformation);
+	if(e->Description)
+		rp_free(e->Description);
+	if(e->ImplName)
+		rp_free(e->ImplName);
 
-	for(unsigned int i = 0; i < impl->NumDevices; i++)
-	{
-		rp_DestroyDeviceInformation(impl->Devices[i]);
-		rp_free(impl->Devices[i]);
-	}
+	rp_free(e);
+}
 
-	for(unsigned int i = 0; i < impl->NumProtocols; i++)
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_NextListItem(const char **cursor, const char *end, long *value)
+{
+	// items are comma separated numbers as rp_ParseNumber reads them. Empty items are skipped the way
+	// rp_strtok skips them, so are items that aren't a number as a whole or are too long to be one
+	char item[MAX_RP1210_LIST_ITEM];
+
+	while(*cursor < end)
 	{
-		rp_DestroyProtocolInformation(impl->Protocols[i]);
-		rp_free(impl->Protocols[i]);
+		const char *start = *cursor;
 
-		rp_DestroyProtocolDeviceMap(impl->ProtocolDeviceMap[i]);
-		rp_free(impl->ProtocolDeviceMap[i]);
-	}
+		while(*cursor < end && **cursor != ',')
+			(*cursor)++;
 
-	if(impl->Name)
-		rp_free(impl->Name);
-	if(impl->DriverPath)
-		rp_free(impl->DriverPath);
-	if(impl->ProtocolDeviceMap)
-		rp_free(impl->ProtocolDeviceMap);
-	if(impl->Devices)
-		rp_free(impl->Devices);
-	if(impl->Protocols)
-		rp_free(impl->Protocols);
+		size_t length = (size_t)(*cursor - start);
 
-	rp_free(impl);
+		if(*cursor < end)
+			(*cursor)++;
+
+		if(length < sizeof(item))
+		{
+			memcpy(item, start, length);
+			item[length] = 0;
+
+			if(rp_ParseNumber(item, value))
+				return true;
+		}
+	}
+
+	return false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroyLoaderError(S_RP1210ImplLoadErr *e)
+unsigned int rp_CountListItems(const S_IniView *list)
 {
-	if(e->Description)
-		rp_free(e->Description);
-	if(e->ImplName)
-		rp_free(e->ImplName);
+	// an upper bound for what rp_NextListItem returns, one item per comma and one more
+	unsigned int count = list->Value ? 1 : 0;
 
-	rp_free(e);
+	for(size_t i = 0; i < list->Length; i++)
+		count += list->Value[i] == ',';
+
+	return count;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_ReadVendorInformation(ORP_HANDLE ini, S_RP1210VendorInformation *vi)
+void rp_ReadIniView(ORP_HANDLE ini, const char *section, const char *key, S_IniView *view)
 {
-	memset(vi, 0, sizeof(S_RP1210VendorInformation));
-	
-	READ_INI_VI_FIELD(ini, vi, Name);
-	READ_INI_VI_FIELD(ini, vi, Address1);
-	READ_INI_VI_FIELD(ini, vi, City);
-	READ_INI_VI_FIELD(ini, vi, Country);
-	READ_INI_VI_FIELD(ini, vi, Postal);
-	READ_INI_VI_FIELD(ini, vi, Telephone);
-	READ_INI_VI_FIELD(ini, vi, Fax);
-	READ_INI_VI_FIELD(ini, vi, VendorURL);
-	READ_INI_VI_FIELD(ini, vi, MessageString);
-	READ_INI_VI_FIELD(ini, vi, ErrorString);
-	READ_INI_VI_FIELD(ini, vi, TimestampWeight);
-	READ_INI_VI_FIELD(ini, vi, Devices);
-	READ_INI_VI_FIELD(ini, vi, Protocols);
+	if(rp_IniGetKeyView(ini, section, key, &view->Value, &view->Length) != ORP_ERR_NO_ERROR)
+	{
+		view->Value = NULL;
+		view->Length = 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadVendorInformation(ORP_HANDLE ini, S_ApiImplScan *scan)
+{
+	READ_INI_VI_FIELD(ini, scan, Name);
+	READ_INI_VI_FIELD(ini, scan, Address1);
+	READ_INI_VI_FIELD(ini, scan, City);
+	READ_INI_VI_FIELD(ini, scan, Country);
+	READ_INI_VI_FIELD(ini, scan, Postal);
+	READ_INI_VI_FIELD(ini, scan, Telephone);
+	READ_INI_VI_FIELD(ini, scan, Fax);
+	READ_INI_VI_FIELD(ini, scan, VendorURL);
+	READ_INI_VI_FIELD(ini, scan, MessageString);
+	READ_INI_VI_FIELD(ini, scan, ErrorString);
+	READ_INI_VI_FIELD(ini, scan, TimestampWeight);
+	READ_INI_VI_FIELD(ini, scan, Devices);
+	READ_INI_VI_FIELD(ini, scan, Protocols);
 
 	#if RP1210_VERSION >= RP1210_VERSION_B
-		READ_INI_VI_FIELD(ini, vi, AutoDetectCapable);
-		READ_INI_VI_FIELD(ini, vi, Version);
-		READ_INI_VI_FIELD(ini, vi, RP1210);
-		READ_INI_VI_FIELD(ini, vi, DebugLevel);
-		READ_INI_VI_FIELD(ini, vi, DebugFile);
-		READ_INI_VI_FIELD(ini, vi, DebugMode);
-		READ_INI_VI_FIELD(ini, vi, DebugFileSize);
-		READ_INI_VI_FIELD(ini, vi, NumberOfRTSCTSSessions);
+		READ_INI_VI_FIELD(ini, scan, AutoDetectCapable);
+		READ_INI_VI_FIELD(ini, scan, Version);
+		READ_INI_VI_FIELD(ini, scan, RP1210);
+		READ_INI_VI_FIELD(ini, scan, DebugLevel);
+		READ_INI_VI_FIELD(ini, scan, DebugFile);
+		READ_INI_VI_FIELD(ini, scan, DebugMode);
+		READ_INI_VI_FIELD(ini, scan, DebugFileSize);
+		READ_INI_VI_FIELD(ini, scan, NumberOfRTSCTSSessions);
 	#endif
 	#if RP1210_VERSION >= RP1210_VERSION_C
-		READ_INI_VI_FIELD(ini, vi, CANFormatsSupported);
-		READ_INI_VI_FIELD(ini, vi, J1939FormatsSupported);
-		READ_INI_VI_FIELD(ini, vi, J1939Addresses);
-		READ_INI_VI_FIELD(ini, vi, CANAutoBaud);
-		READ_INI_VI_FIELD(ini, vi, J1708FormatsSupported);
-		READ_INI_VI_FIELD(ini, vi, ISO15765FormatsSupported);
+		READ_INI_VI_FIELD(ini, scan, CANFormatsSupported);
+		READ_INI_VI_FIELD(ini, scan, J1939FormatsSupported);
+		READ_INI_VI_FIELD(ini, scan, J1939Addresses);
+		READ_INI_VI_FIELD(ini, scan, CANAutoBaud);
+		READ_INI_VI_FIELD(ini, scan, J1708FormatsSupported);
+		READ_INI_VI_FIELD(ini, scan, ISO15765FormatsSupported);
 	#endif
 }
 
@@ -494,409 +932,1429 @@ void rp_ReadVendorInformation(ORP_HANDLE ini, S_RP1210VendorInformation *vi)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_EnumIniSections(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, const char *sections, const char *sectionDelim, const char *sectionPrefix, EnumIniSectionCallback callback)
+unsigned int rp_ReadSections(ORP_HANDLE hIni, const S_IniView *list, const char *sectionPrefix, const char *const *keys, unsigned int numKeys, S_IniView *views)
 {
+	// one pass over the list, views has room for rp_CountListItems(list) sections
 	char fullSectionName[MAX_RP1210_SECTION_NAME];
-	unsigned short sectionIndex = 0;
+	unsigned int numSections = 0;
 
-	char *tokContext = NULL;
-	char *tokPtr = rp_malloc(strlen(sections) + 1);
-	char *tok = tokPtr;
-	if(tok)
-	{
-		strcpy(tok, sections);
-		tok = rp_strtok(tok, sectionDelim, &tokContext);
-	}
+	const char *cursor = list->Value;
+	const char *end = list->Value + list->Length;
+	long sectionId = 0;
 
-	if(tok)
+	while(list->Value && rp_NextListItem(&cursor, end, &sectionId))
 	{
-		do
+		if(sectionId >= 0 && snprintf(fullSectionName, MAX_RP1210_SECTION_NAME, "%s%ld", sectionPrefix, sectionId) > 0)
 		{
-			long devId = rp_strtol(tok);
-			if(rpGetLastError() != ORP_ERR_NO_ERROR)
-				continue;
+			if(rp_IniHasSection(hIni, fullSectionName))
+			{
+				for(unsigned int i = 0; i < numKeys; i++)
+					rp_ReadIniView(hIni, fullSectionName, keys[i], &views[numSections * numKeys + i]);
+
+				numSections++;
+			}
 			else
+				rp_ClearLastError(); // a listed section that doesn't exist is skipped, it isn't an error
+		}
+	}
+
+	return numSections;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ScanApiImplIni(ORP_HANDLE hIni, S_ApiImplScan *scan)
+{
+	// every key is looked up once. The device and protocol tables are sized from
+	// the comma counts of their lists, sections that don't exist only leave room unused
+	const S_IniView *devices = &scan->Vendor[offsetof(S_RP1210VendorInformation, Devices) / sizeof(char *)];
+	const S_IniView *protocols = &scan->Vendor[offsetof(S_RP1210VendorInformation, Protocols) / sizeof(char *)];
+
+	rp_ReadVendorInformation(hIni, scan);
+
+	unsigned int maxDevices = rp_CountListItems(devices);
+	unsigned int maxProtocols = rp_CountListItems(protocols);
+
+	scan->Devices = rp_malloc(((size_t)maxDevices * NUM_DEVICE_FIELDS + (size_t)maxProtocols * NUM_PROTOCOL_FIELDS + 1) * sizeof(S_IniView));
+	if(scan->Devices)
+	{
+		scan->Protocols = scan->Devices + (size_t)maxDevices * NUM_DEVICE_FIELDS;
+		scan->NumDevices = rp_ReadSections(hIni, devices, "DeviceInformation", gDeviceKeys, NUM_DEVICE_FIELDS, scan->Devices);
+		scan->NumProtocols = rp_ReadSections(hIni, protocols, "ProtocolInformation", gProtocolKeys, NUM_PROTOCOL_FIELDS, scan->Protocols);
+
+		if(rpGetLastError() == ORP_ERR_INI_KEYNOTFOUND)
+			rp_ClearLastError();
+	}
+
+	return scan->Devices != NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadProtocolDeviceIds(S_ApiImplBuilder *builder, const S_IniView *list, S_ProtocolDeviceMap *map)
+{
+	// while measuring only room for the list is counted, IDs beyond NumDevices are dropped either way
+	unsigned int maxDeviceIds = builder->Size.NumDevices;
+
+	if(!builder->Impl)
+	{
+		unsigned int count = rp_CountListItems(list);
+		builder->Size.NumDeviceIds += count < maxDeviceIds ? count : maxDeviceIds;
+	}
+	else if(list->Value)
+	{
+		const char *cursor = list->Value;
+		const char *end = list->Value + list->Length;
+		long devId = 0;
+
+		map->DeviceIds = builder->DeviceIds;
+
+		while(map->NumDevices < maxDeviceIds && rp_NextListItem(&cursor, end, &devId))
+		{
+			if(devId >= 0 && devId <= UINT32_MAX)
+				map->DeviceIds[map->NumDevices++] = (unsigned int)devId;
+		}
+
+		builder->DeviceIds += map->NumDevices;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AddViews(S_ApiImplBuilder *builder, const S_IniView *views, unsigned int count, char **values)
+{
+	// values is only written while filling, like rp_ReadDiscoveryCacheImplStrings
+	for(unsigned int i = 0; i < count; i++)
+	{
+		char *v = rp_ImplAddString(builder, views[i].Value, views[i].Length);
+
+		if(builder->Impl)
+			values[i] = v;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int rp_FindDeviceById(S_RP1210ApiImpl *impl, unsigned int deviceId)
+{
+	const S_LookupIndex *index = &impl->DeviceIdIndex;
+
+	for(uint32_t i = rp_HashId(deviceId) & index->Mask; index->Slots[i]; i = (i + 1) & index->Mask)
+	{
+		if(impl->DeviceIdValues[index->Slots[i] - 1] == deviceId)
+			return (int)index->Slots[i] - 1;
+	}
+
+	return -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int rp_FindProtocol(S_RP1210ApiImpl *impl, const char *protocolString)
+{
+	const S_LookupIndex *index = &impl->ProtocolIndex;
+
+	for(uint32_t i = rp_HashName(protocolString) & index->Mask; index->Slots[i]; i = (i + 1) & index->Mask)
+	{
+		if(strcmp(impl->Protocols[index->Slots[i] - 1]->ProtocolString, protocolString) == 0)
+			return (int)index->Slots[i] - 1;
+	}
+
+	return -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_BuildProtocolDeviceMatrix(S_RP1210ApiImpl *impl)
+{
+	// resolves each protocol's device IDs once against DeviceIdIndex. The bit matrix
+	// drops IDs listed twice, the inverted lists answer the capability queries.
+	// rp_LayoutApiImpl sized the lists for every device map entry
+	unsigned int numEntries = 0;
+
+	for(unsigned int p = 0; p < impl->NumProtocols; p++)
+	{
+		S_ProtocolDeviceMap *map = impl->ProtocolDeviceMap[p];
+		uint32_t *row = &impl->ProtocolDeviceBits[p * impl->DeviceBitWords];
+
+		impl->ProtocolDeviceStart[p] = numEntries;
+		for(unsigned int i = 0; map && i < map->NumDevices; i++)
+		{
+			int d = rp_FindDeviceById(impl, map->DeviceIds[i]);
+			if(d >= 0 && !(row[d / 32] & (1u << (d % 32))))
+			{
+				row[d / 32] |= 1u << (d % 32);
+				impl->ProtocolDevices[numEntries++] = (unsigned short)d;
+				impl->DeviceProtocolStart[d + 2]++;
+			}
+		}
+	}
+	impl->ProtocolDeviceStart[impl->NumProtocols] = numEntries;
+
+	// counts sit two slots ahead, so after the prefix sum slot d + 1 is the write
+	// position of device d and ends up as its end offset once the lists are filled
+	for(unsigned int d = 0; d < impl->NumDevices; d++)
+		impl->DeviceProtocolStart[d + 2] += impl->DeviceProtocolStart[d + 1];
+
+	for(unsigned int p = 0; p < impl->NumProtocols; p++)
+	{
+		for(unsigned int i = impl->ProtocolDeviceStart[p]; i < impl->ProtocolDeviceStart[p + 1]; i++)
+			impl->DeviceProtocols[impl->DeviceProtocolStart[impl->ProtocolDevices[i] + 1]++] = (unsigned short)p;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_IndexApiImpl(S_RP1210ApiImpl *impl)
+{
+	// every implementation in a discovery is indexed, the lookups rely on it.
+	// The index tables are part of the implementation's block
+	for(unsigned int i = 0; i < impl->NumDevices; i++)
+	{
+		S_RP1210DeviceInformation *devInfo = impl->Devices[i];
+
+		if(devInfo->DeviceName)
+			rp_AddLookupEntry(&impl->DeviceNameIndex, rp_HashName(devInfo->DeviceName), i);
+
+		if(devInfo->DeviceID && rp_ParseDeviceId(devInfo->DeviceID, &impl->DeviceIdValues[i]))
+			rp_AddLookupEntry(&impl->DeviceIdIndex, rp_HashId(impl->DeviceIdValues[i]), i);
+	}
+
+	for(unsigned int i = 0; i < impl->NumProtocols; i++)
+	{
+		if(impl->Protocols[i]->ProtocolString)
+			rp_AddLookupEntry(&impl->ProtocolIndex, rp_HashName(impl->Protocols[i]->ProtocolString), i);
+	}
+
+	rp_BuildProtocolDeviceMatrix(impl);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_CopyApiImpl(S_ApiImplBuilder *builder, const S_ApiImplScan *scan, const char *implName, const char *driverPath)
+{
+	// copies what rp_ScanApiImplIni found, run to measure and again to fill
+	S_RP1210ApiImpl *impl = builder->Impl;
+	const unsigned int devicesField = offsetof(S_RP1210ProtocolInformation, Devices) / sizeof(char *);
+
+	char *name = rp_ImplAddString(builder, implName, strlen(implName));
+	char *path = rp_ImplAddString(builder, driverPath, strlen(driverPath));
+
+	if(impl)
+	{
+		impl->Name = name;
+		impl->DriverPath = path;
+	}
+
+	rp_AddViews(builder, scan->Vendor, NUM_VENDOR_FIELDS, impl ? (char **)&impl->VendorInformation : NULL);
+
+	for(unsigned int i = 0; i < scan->NumDevices; i++)
+		rp_AddViews(builder, &scan->Devices[i * NUM_DEVICE_FIELDS], NUM_DEVICE_FIELDS, impl ? (char **)impl->Devices[i] : NULL);
+
+	for(unsigned int i = 0; i < scan->NumProtocols; i++)
+	{
+		const S_IniView *views = &scan->Protocols[i * NUM_PROTOCOL_FIELDS];
+
+		rp_AddViews(builder, views, NUM_PROTOCOL_FIELDS, impl ? (char **)impl->Protocols[i] : NULL);
+		rp_ReadProtocolDeviceIds(builder, &views[devicesField], impl ? impl->ProtocolDeviceMap[i] : NULL);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_RP1210ApiImpl *rp_ReadRP1210ImplIni(const char *implName, S_DiscoveryFile *file)
+{
+	S_RP1210ApiImpl *impl = NULL;
+	char *implPath = NULL;
+	ORP_ERR r = rp_GetRp1210IniPath(&implPath, "%s%s%s", RP1210_HOME_SUBDIR, implName, ".ini");
+
+	if(!ORP_IS_ERR(r))
+	{
+		S_IniConfig config = rp_CreateDefaultConfig();
+		config.MemoryMapped = true;
+
+		file->Path = implPath; // kept to check the file for changes later
+		rp_StatDiscoveryFile(file);
+
+		ORP_HANDLE hIni = rp_IniOpen(implPath, &config);
+		if(hIni)
+		{
+			char *driverPath = NULL;
+			rp_GetRp1210DriverPath(true, &driverPath, "%s%s%s.%s", RP1210_HOME_SUBDIR, RP1210_DRIVER_SUBDIR, implName, RP1210_DRIVER_EXT);
+
+			S_ApiImplScan scan;
+			memset(&scan, 0, sizeof(S_ApiImplScan));
+
+			if(rpGetLastError() == ORP_ERR_NO_ERROR && rp_ScanApiImplIni(hIni, &scan))
 			{
-				if(devId >= 0)
+				// measure, then copy into the one block holding the whole implementation
+				S_ApiImplBuilder builder;
+				memset(&builder, 0, sizeof(S_ApiImplBuilder));
+
+				builder.Size.NumDevices = scan.NumDevices;
+				builder.Size.NumProtocols = scan.NumProtocols;
+				rp_CopyApiImpl(&builder, &scan, implName, driverPath);
+
+				if(rp_CreateApiImpl(&builder))
 				{
-					if(snprintf(fullSectionName, MAX_RP1210_SECTION_NAME, "%s%ld", sectionPrefix, devId) > 0)
-					{
-						if(rp_IniHasSection(hIni, fullSectionName) && callback)
-							callback(hIni, impl, sectionIndex++, fullSectionName);
-					}
-					else
-						continue;
+					impl = builder.Impl;
+					rp_CopyApiImpl(&builder, &scan, implName, driverPath);
+					rp_IndexApiImpl(impl);
+				}
+			}
+
+			rp_free(scan.Devices);
+			rp_free(driverPath);
+			rpFreeHandle(hIni);
+		}
+	}
+
+	return impl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_RP1210ApiImpl *rp_CreateRP1210Impl(const char *implName, S_RP1210ImplLoadErr **loadError, S_DiscoveryFile *file)
+{
+	S_RP1210ApiImpl *impl = rp_ReadRP1210ImplIni(implName, file);
+
+	if(!impl && loadError)
+	{
+		// save error generated in rp_ReadRP1210ImplIni
+		// if unable to save it, retain last error in rpGetLastError from rp_ReadRP1210ImplIni
+		// this means errors below will be swallowed (only failures below are malloc fails anyway)
+		S_RP1210ImplLoadErr *le = rp_malloc(sizeof(S_RP1210ImplLoadErr));
+		if(le)
+		{
+			memset(le, 0, sizeof(S_RP1210ImplLoadErr));
+			const char *e = rpGetLastErrorDesc();
+
+			le->Description = rp_malloc(strlen(e) + 1);
+			if(le->Description)
+			{
+				le->ImplName = rp_malloc(strlen(implName) + 1);
+				if(le->ImplName)
+				{
+					le->Error = rpGetLastError();
+
+					strcpy(le->Description, e);
+					strcpy(le->ImplName, implName);
+
+					rp_SetLastError(ORP_ERR_NO_ERROR, NULL);
 				}
-				else
-					continue;
 			}
 
+			if(rpGetLastError() != ORP_ERR_NO_ERROR)
+				rp_DestroyLoaderError(le);
+			else
+				*loadError = le;
+		}
+	}
+
+	return impl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_DestroyDiscovery(S_Discovery *discovery)
+{
+	S_RP1210ApiImpls *impls = &discovery->Impls;
+
+	if(impls->Impls)
+		for(int i = 0; i < impls->NumImpls; i++)
+			if(impls->Impls[i]) // a lazy discovery's implementation may never have been loaded
+				rp_DestroyApiImpl(impls->Impls[i]);
+
+	if(impls->LoadErrors)
+		for(int i = 0; i < impls->NumLoadErrors; i++)
+			rp_DestroyLoaderError(impls->LoadErrors[i]);
+
+	rp_free(impls->LoadErrors);
+	rp_free(impls->Impls);
+
+	if(discovery->Files)
+		for(unsigned int i = 0; i < discovery->NumFiles; i++)
+			rp_free(discovery->Files[i].Path);
+
+	rp_free(discovery->Files);
+
+	if(discovery->LazyImpls)
+		for(int i = 0; i < impls->NumImpls; i++)
+			rp_free(discovery->LazyImpls[i].Name);
+
+	rp_free(discovery->LazyImpls);
+	rp_free(discovery->ImplIndex.Slots);
+	rp_free(discovery);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const char *rp_DiscoveryImplName(S_Discovery *discovery, unsigned int index)
+{
+	// a lazy discovery knows its implementations' names before it has loaded them
+	return discovery->LazyImpls ? discovery->LazyImpls[index].Name : discovery->Impls.Impls[index]->Name;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_IndexDiscovery(S_Discovery *discovery)
+{
+	bool indexed = rp_CreateLookupIndex(&discovery->ImplIndex, discovery->Impls.NumImpls);
+
+	for(unsigned int i = 0; indexed && i < discovery->Impls.NumImpls; i++)
+		rp_AddLookupEntry(&discovery->ImplIndex, rp_HashName(rp_DiscoveryImplName(discovery, i)), i);
+
+	return indexed;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReleaseDiscovery(S_Discovery *discovery)
+{
+	if(rp_AtomicDecrement(&discovery->RefCount) == 0)
+		rp_DestroyDiscovery(discovery);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_FreeApiImpls(ORP_HANDLE hImpls)
+{
+	rp_ReleaseDiscovery(rp_HandleToTarget(hImpls));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_LoadImplTask(void *userPtr, unsigned int index)
+{
+	S_ImplLoad *load = (S_ImplLoad *)userPtr + index;
+
+	// the load error is built from this thread's last error, so it's captured on the worker.
+	// What rp_CreateRP1210Impl couldn't capture is handed back through Error, errors left
+	// behind by a vendor that loaded or got a load error aren't the caller's concern
+	rp_ClearLastError();
+	load->Impl = rp_CreateRP1210Impl(load->Name, &load->LoadError, load->File);
+
+	if(!load->Impl && !load->LoadError)
+	{
+		const char *desc = rpGetLastErrorDesc();
+
+		load->Error = rpGetLastError();
+		load->ErrorDesc = rp_malloc(strlen(desc) + 1);
+
+		if(load->ErrorDesc)
+			strcpy(load->ErrorDesc, desc);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Discovery *rp_ReadDiscovery(void)
+{
+	S_Discovery *discovery = rp_mallocZ(sizeof(S_Discovery));
+	if(!discovery)
+		return NULL;
+
+	discovery->RefCount = 1;
+	discovery->CheckedTime = (long)rp_GetTickCount();
+
+	S_DiscoveryFile iniFile = { 0 };
+	char *rp1210IniImpls = NULL;
+	ORP_ERR r = rp_ReadRP1210Ini(&rp1210IniImpls, &iniFile);
+
+	if(!ORP_IS_ERR(r))
+	{
+		const char delim[] = ",";
+		unsigned short numImpls = 0;
+		unsigned short numLoadErrs = 0;
+		unsigned short maxImpls = rp_GetRP1210ImplMax(rp1210IniImpls, delim);
+
+		discovery->Files = rp_mallocZ((maxImpls + 1) * sizeof(S_DiscoveryFile));
+		if(discovery->Files)
+		{
+			discovery->Files[0] = iniFile;
+			discovery->NumFiles = 1;
+			iniFile.Path = NULL;
+		}
+		else
+			r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+		if(!ORP_IS_ERR(r) && maxImpls > 0)
+		{
+			S_RP1210ApiImpl **localImpls = rp_malloc(maxImpls * sizeof(S_RP1210ApiImpl *));
+			S_RP1210ImplLoadErr **loadErrors = rp_mallocZ(maxImpls * sizeof(S_RP1210ImplLoadErr *));
+			S_ImplLoad *loads = rp_mallocZ(maxImpls * sizeof(S_ImplLoad));
+			if(localImpls && loadErrors && loads)
+			{
+				char *tok = rp1210IniImpls;
+				char *tokContext = NULL;
+				unsigned int numLoads = 0;
+
+				tok = rp_strtok(tok, delim, &tokContext);
+				while(tok != NULL)
+				{
+					assert(numLoads < maxImpls); // shouldn't happen, but still....
+
+					loads[numLoads].Name = tok;
+					loads[numLoads].File = &discovery->Files[discovery->NumFiles++];
+					numLoads++;
+
+					tok = rp_strtok(NULL, delim, &tokContext);
+				}
+
+				// every vendor INI is independent, they're read in parallel and merged back in list order
+				unsigned int numThreads = rp_GetProcessorCount();
+				if(numThreads > DISCOVERY_MAX_THREADS)
+					numThreads = DISCOVERY_MAX_THREADS;
+
+				rp_ParallelFor(numLoads, numThreads, rp_LoadImplTask, loads);
+
+				// this thread runs loads as well, what they left behind has been handed back through loads
+				rp_ClearLastError();
+
+				S_ImplLoad *lost = NULL;
+
+				for(unsigned int i = 0; i < numLoads; i++)
+				{
+					if(loads[i].Impl)
+						localImpls[numImpls++] = loads[i].Impl;
+					else if(loads[i].LoadError)
+						loadErrors[numLoadErrs++] = loads[i].LoadError;
+					else if(!lost && loads[i].Error != ORP_ERR_NO_ERROR)
+						lost = &loads[i];
+				}
+
+				// an error a worker couldn't capture in a load error isn't fatal, but the caller's thread still sees it
+				if(lost)
+					rp_RestoreLastError(lost->Error, lost->ErrorDesc);
+
+				for(unsigned int i = 0; i < numLoads; i++)
+					rp_free(loads[i].ErrorDesc);
+			}
+			else
+				r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+			rp_free(loads);
+
+			if(!ORP_IS_ERR(r))
+				rp_InitApiImpls(&discovery->Impls, localImpls, numImpls, loadErrors, numLoadErrs);
+			else
+			{
+				if(localImpls)
+					for(int i = 0; i < numImpls; i++)
+						rp_DestroyApiImpl(localImpls[i]);
+
+				if(loadErrors)
+					for(int i = 0; i < numLoadErrs; i++)
+						rp_DestroyLoaderError(loadErrors[i]);
+
+				rp_free(localImpls);
+				rp_free(loadErrors);
+			}
+		}
+
+		rp_free(rp1210IniImpls);
+	}
+
+	rp_free(iniFile.Path);
+
+	if(!ORP_IS_ERR(r) && !rp_IndexDiscovery(discovery))
+		r = ORP_ERR_MEM_ALLOC;
+
+	if(ORP_IS_ERR(r))
+	{
+		rp_DestroyDiscovery(discovery);
+		discovery = NULL;
+	}
+
+	return discovery;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_DiscoveryCacheLayout(void)
+{
+	return (uint32_t)(NUM_VENDOR_FIELDS | NUM_DEVICE_FIELDS << 8 | NUM_PROTOCOL_FIELDS << 16);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_DiscoveryCacheChecksum(const S_DiscoveryCacheHeader *header)
+{
+	return rp_HashString((const char *)header, offsetof(S_DiscoveryCacheHeader, Checksum), false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint64_t rp_DiscoveryCacheStringsSize(char *const *values, unsigned int count)
+{
+	uint64_t size = 0;
+
+	for(unsigned int i = 0; i < count; i++)
+		size += values[i] ? strlen(values[i]) + 1 : 0;
+
+	return size;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_DiscoveryCacheAddStrings(char *strings, uint32_t *stringsSize, char *const *values, unsigned int count, uint32_t *offsets)
+{
+	for(unsigned int i = 0; i < count; i++)
+	{
+		if(values[i])
+		{
+			size_t size = strlen(values[i]) + 1;
+
+			memcpy(strings + *stringsSize, values[i], size);
+			offsets[i] = *stringsSize;
+			*stringsSize += (uint32_t)size;
+		}
+		else
+			offsets[i] = DISCOVERY_CACHE_NULL;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned char *rp_BuildDiscoveryCache(S_Discovery *discovery, uint32_t *imageSize)
+{
+	S_RP1210ApiImpls *impls = &discovery->Impls;
+	uint64_t numDevices = 0, numProtocols = 0, numDeviceIds = 0, stringsSize = 0;
+
+	for(unsigned int i = 0; i < discovery->NumFiles; i++)
+		stringsSize += rp_DiscoveryCacheStringsSize(&discovery->Files[i].Path, 1);
+
+	for(unsigned int i = 0; i < impls->NumImpls; i++)
+	{
+		S_RP1210ApiImpl *impl = impls->Impls[i];
+
+		stringsSize += rp_DiscoveryCacheStringsSize(&impl->Name, 1) + rp_DiscoveryCacheStringsSize(&impl->DriverPath, 1)
+			+ rp_DiscoveryCacheStringsSize((char *const *)&impl->VendorInformation, NUM_VENDOR_FIELDS);
+
+		for(unsigned int j = 0; j < impl->NumDevices; j++)
+			stringsSize += rp_DiscoveryCacheStringsSize((char *const *)impl->Devices[j], NUM_DEVICE_FIELDS);
+
+		for(unsigned int j = 0; j < impl->NumProtocols; j++)
+		{
+			stringsSize += rp_DiscoveryCacheStringsSize((char *const *)impl->Protocols[j], NUM_PROTOCOL_FIELDS);
+			numDeviceIds += impl->ProtocolDeviceMap[j]->NumDevices;
+		}
+
+		numDevices += impl->NumDevices;
+		numProtocols += impl->NumProtocols;
+	}
+
+	for(unsigned int i = 0; i < impls->NumLoadErrors; i++)
+		stringsSize += rp_DiscoveryCacheStringsSize(&impls->LoadErrors[i]->ImplName, 1) + rp_DiscoveryCacheStringsSize(&impls->LoadErrors[i]->Description, 1);
+
+	uint64_t size = sizeof(S_DiscoveryCacheHeader) + discovery->NumFiles * sizeof(S_DiscoveryCacheFile) + impls->NumImpls * sizeof(S_DiscoveryCacheImpl)
+		+ numDevices * sizeof(S_DiscoveryCacheDevice) + numProtocols * sizeof(S_DiscoveryCacheProtocol) + numDeviceIds * sizeof(uint32_t)
+		+ impls->NumLoadErrors * sizeof(S_DiscoveryCacheLoadErr) + stringsSize;
+
+	size = (size + sizeof(uint32_t) - 1) & ~(uint64_t)(sizeof(uint32_t) - 1); // whole words for the body checksum
+
+	unsigned char *image = size < DISCOVERY_CACHE_NULL ? rp_mallocZ((size_t)size) : NULL;
+
+	if(image)
+	{
+		S_DiscoveryCacheHeader *header = (S_DiscoveryCacheHeader *)image;
+
+		header->Magic = DISCOVERY_CACHE_MAGIC;
+		header->Version = DISCOVERY_CACHE_VERSION;
+		header->HeaderSize = sizeof(S_DiscoveryCacheHeader);
+		header->ImageSize = (uint32_t)size;
+		header->Layout = rp_DiscoveryCacheLayout();
+
+		header->Files = sizeof(S_DiscoveryCacheHeader);
+		header->NumFiles = discovery->NumFiles;
+		header->Impls = header->Files + header->NumFiles * sizeof(S_DiscoveryCacheFile);
+		header->NumImpls = impls->NumImpls;
+		header->Devices = header->Impls + header->NumImpls * sizeof(S_DiscoveryCacheImpl);
+		header->NumDevices = (uint32_t)numDevices;
+		header->Protocols = header->Devices + header->NumDevices * sizeof(S_DiscoveryCacheDevice);
+		header->NumProtocols = (uint32_t)numProtocols;
+		header->DeviceIds = header->Protocols + header->NumProtocols * sizeof(S_DiscoveryCacheProtocol);
+		header->NumDeviceIds = (uint32_t)numDeviceIds;
+		header->LoadErrors = header->DeviceIds + header->NumDeviceIds * sizeof(uint32_t);
+		header->NumLoadErrors = impls->NumLoadErrors;
+		header->Strings = header->LoadErrors + header->NumLoadErrors * sizeof(S_DiscoveryCacheLoadErr);
+		header->StringsSize = (uint32_t)stringsSize;
+
+		S_DiscoveryCacheFile *files = (S_DiscoveryCacheFile *)(image + header->Files);
+		S_DiscoveryCacheImpl *implRecords = (S_DiscoveryCacheImpl *)(image + header->Impls);
+		S_DiscoveryCacheDevice *devices = (S_DiscoveryCacheDevice *)(image + header->Devices);
+		S_DiscoveryCacheProtocol *protocols = (S_DiscoveryCacheProtocol *)(image + header->Protocols);
+		uint32_t *deviceIds = (uint32_t *)(image + header->DeviceIds);
+		S_DiscoveryCacheLoadErr *loadErrors = (S_DiscoveryCacheLoadErr *)(image + header->LoadErrors);
+		char *strings = (char *)(image + header->Strings);
+		uint32_t deviceIndex = 0, protocolIndex = 0, deviceIdIndex = 0, stringsUsed = 0;
+
+		for(unsigned int i = 0; i < discovery->NumFiles; i++)
+		{
+			S_DiscoveryFile *file = &discovery->Files[i];
+
+			files[i].Size = file->Info.Size;
+			files[i].ModifiedTime = file->Info.ModifiedTime;
+			files[i].Device = file->Info.Device;
+			files[i].Inode = file->Info.Inode;
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, &file->Path, 1, &files[i].Path);
+		}
+
+		for(unsigned int i = 0; i < impls->NumImpls; i++)
+		{
+			S_RP1210ApiImpl *impl = impls->Impls[i];
+			S_DiscoveryCacheImpl *record = &implRecords[i];
+
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, &impl->Name, 1, &record->Name);
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, &impl->DriverPath, 1, &record->DriverPath);
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, (char *const *)&impl->VendorInformation, NUM_VENDOR_FIELDS, record->Vendor);
+
+			record->FirstDevice = deviceIndex;
+			record->NumDevices = impl->NumDevices;
+			record->FirstProtocol = protocolIndex;
+			record->NumProtocols = impl->NumProtocols;
+
+			for(unsigned int j = 0; j < impl->NumDevices; j++)
+				rp_DiscoveryCacheAddStrings(strings, &stringsUsed, (char *const *)impl->Devices[j], NUM_DEVICE_FIELDS, devices[deviceIndex++].Fields);
+
+			for(unsigned int j = 0; j < impl->NumProtocols; j++)
+			{
+				S_ProtocolDeviceMap *map = impl->ProtocolDeviceMap[j];
+				S_DiscoveryCacheProtocol *protocol = &protocols[protocolIndex++];
+
+				rp_DiscoveryCacheAddStrings(strings, &stringsUsed, (char *const *)impl->Protocols[j], NUM_PROTOCOL_FIELDS, protocol->Fields);
+				protocol->ProtocolId = map->ProtocolId;
+				protocol->FirstDeviceId = deviceIdIndex;
+				protocol->NumDeviceIds = map->NumDevices;
+
+				for(unsigned int k = 0; k < map->NumDevices; k++)
+					deviceIds[deviceIdIndex++] = map->DeviceIds[k];
+			}
+		}
+
+		for(unsigned int i = 0; i < impls->NumLoadErrors; i++)
+		{
+			S_RP1210ImplLoadErr *e = impls->LoadErrors[i];
+
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, &e->ImplName, 1, &loadErrors[i].ImplName);
+			rp_DiscoveryCacheAddStrings(strings, &stringsUsed, &e->Description, 1, &loadErrors[i].Description);
+			loadErrors[i].Error = (int32_t)e->Error;
+		}
+
+		header->BodyChecksum = rp_ImageBodyChecksum(image, sizeof(S_DiscoveryCacheHeader), header->ImageSize);
+		header->Checksum = rp_DiscoveryCacheChecksum(header);
+		*imageSize = header->ImageSize;
+	}
+
+	return image;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SaveDiscoveryCache(S_Discovery *discovery)
+{
+	// best effort, the RP1210 home directory may not be writable, failures only mean the next process reads the INI files again
+	uint32_t imageSize = 0;
+	unsigned char *image = rp_BuildDiscoveryCache(discovery, &imageSize);
+	char *cachePath = NULL;
+
+	if(image && rp_GetRp1210IniPath(&cachePath, "%s%s", RP1210_HOME_SUBDIR, DISCOVERY_CACHE_NAME) == ORP_ERR_NO_ERROR)
+	{
+		rp_SaveImage(cachePath, image, imageSize);
+		rp_free(cachePath);
+	}
+
+	rp_free(image);
+	rp_ClearLastError();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_DiscoveryCacheStrings(const S_DiscoveryCacheHeader *header, const uint32_t *offsets, unsigned int count)
+{
+	const char *strings = (const char *)header + header->Strings;
+	bool valid = true;
+
+	for(unsigned int i = 0; valid && i < count; i++)
+		valid = offsets[i] == DISCOVERY_CACHE_NULL
+			|| (offsets[i] < header->StringsSize && memchr(strings + offsets[i], 0, header->StringsSize - offsets[i]) != NULL);
+
+	return valid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ValidateDiscoveryCache(const unsigned char *image, uint64_t imageSize)
+{
+	// the image is copied into a discovery without further checks, so it must be structurally sound
+	const S_DiscoveryCacheHeader *header = (const S_DiscoveryCacheHeader *)image;
+	bool valid = image && imageSize >= sizeof(S_DiscoveryCacheHeader) && imageSize <= UINT32_MAX;
+
+	valid = valid && header->Magic == DISCOVERY_CACHE_MAGIC && header->Version == DISCOVERY_CACHE_VERSION
+		&& header->HeaderSize == sizeof(S_DiscoveryCacheHeader) && header->ImageSize == imageSize
+		&& header->Checksum == rp_DiscoveryCacheChecksum(header) && header->Layout == rp_DiscoveryCacheLayout()
+		&& imageSize % sizeof(uint32_t) == 0 && header->BodyChecksum == rp_ImageBodyChecksum(image, sizeof(S_DiscoveryCacheHeader), header->ImageSize);
+
+	valid = valid && header->NumFiles > 0 && header->NumImpls <= USHRT_MAX && header->NumLoadErrors <= USHRT_MAX
+		&& header->Files % sizeof(uint64_t) == 0 && rp_ImageRange(header->Files, header->NumFiles, sizeof(S_DiscoveryCacheFile), imageSize)
+		&& rp_ImageRange(header->Impls, header->NumImpls, sizeof(S_DiscoveryCacheImpl), imageSize)
+		&& rp_ImageRange(header->Devices, header->NumDevices, sizeof(S_DiscoveryCacheDevice), imageSize)
+		&& rp_ImageRange(header->Protocols, header->NumProtocols, sizeof(S_DiscoveryCacheProtocol), imageSize)
+		&& rp_ImageRange(header->DeviceIds, header->NumDeviceIds, sizeof(uint32_t), imageSize)
+		&& rp_ImageRange(header->LoadErrors, header->NumLoadErrors, sizeof(S_DiscoveryCacheLoadErr), imageSize)
+		&& rp_ImageRange(header->Strings, header->StringsSize, 1, imageSize);
+
+	const S_DiscoveryCacheFile *files = (const S_DiscoveryCacheFile *)(image + header->Files);
+	const S_DiscoveryCacheImpl *impls = (const S_DiscoveryCacheImpl *)(image + header->Impls);
+	const S_DiscoveryCacheDevice *devices = (const S_DiscoveryCacheDevice *)(image + header->Devices);
+	const S_DiscoveryCacheProtocol *protocols = (const S_DiscoveryCacheProtocol *)(image + header->Protocols);
+	const S_DiscoveryCacheLoadErr *loadErrors = (const S_DiscoveryCacheLoadErr *)(image + header->LoadErrors);
+
+	valid = valid && files[0].Path != DISCOVERY_CACHE_NULL;
+
+	for(uint32_t i = 0; valid && i < header->NumFiles; i++)
+		valid = rp_DiscoveryCacheStrings(header, &files[i].Path, 1);
+
+	for(uint32_t i = 0; valid && i < header->NumImpls; i++)
+	{
+		const S_DiscoveryCacheImpl *impl = &impls[i];
+
+		valid = rp_DiscoveryCacheStrings(header, &impl->Name, 1) && rp_DiscoveryCacheStrings(header, &impl->DriverPath, 1)
+			&& rp_DiscoveryCacheStrings(header, impl->Vendor, NUM_VENDOR_FIELDS)
+			&& impl->NumDevices <= USHRT_MAX && impl->FirstDevice <= header->NumDevices && impl->NumDevices <= header->NumDevices - impl->FirstDevice
+			&& impl->NumProtocols <= USHRT_MAX && impl->FirstProtocol <= header->NumProtocols && impl->NumProtocols <= header->NumProtocols - impl->FirstProtocol;
+
+		// a protocol device map never has more entries than its implementation has devices
+		for(uint32_t j = 0; valid && j < impl->NumProtocols; j++)
+			valid = protocols[impl->FirstProtocol + j].NumDeviceIds <= impl->NumDevices;
+	}
+
+	for(uint32_t i = 0; valid && i < header->NumDevices; i++)
+		valid = rp_DiscoveryCacheStrings(header, devices[i].Fields, NUM_DEVICE_FIELDS);
+
+	for(uint32_t i = 0; valid && i < header->NumProtocols; i++)
+		valid = rp_DiscoveryCacheStrings(header, protocols[i].Fields, NUM_PROTOCOL_FIELDS)
+			&& protocols[i].FirstDeviceId <= header->NumDeviceIds && protocols[i].NumDeviceIds <= header->NumDeviceIds - protocols[i].FirstDeviceId;
+
+	for(uint32_t i = 0; valid && i < header->NumLoadErrors; i++)
+		valid = rp_DiscoveryCacheStrings(header, &loadErrors[i].ImplName, 1) && rp_DiscoveryCacheStrings(header, &loadErrors[i].Description, 1);
+
+	return valid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_DiscoveryCacheCurrent(const unsigned char *image, const char *iniPath)
+{
+	// the cache was built from the INI files as they were when stat'ed, any of them changing since makes it stale
+	const S_DiscoveryCacheHeader *header = (const S_DiscoveryCacheHeader *)image;
+	const S_DiscoveryCacheFile *files = (const S_DiscoveryCacheFile *)(image + header->Files);
+	const char *strings = (const char *)image + header->Strings;
+	bool current = strcmp(strings + files[0].Path, iniPath) == 0;
+
+	for(uint32_t i = 0; current && i < header->NumFiles; i++)
+	{
+		if(files[i].Path != DISCOVERY_CACHE_NULL)
+		{
+			S_DiscoveryFile file = { .Path = (char *)strings + files[i].Path };
+
+			rp_StatDiscoveryFile(&file);
+			current = file.Info.Size == files[i].Size && file.Info.ModifiedTime == files[i].ModifiedTime
+				&& file.Info.Device == files[i].Device && file.Info.Inode == files[i].Inode;
+		}
+	}
+
+	return current;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadDiscoveryCacheStrings(const S_DiscoveryCacheHeader *header, const uint32_t *offsets, unsigned int count, char **values)
+{
+	const char *strings = (const char *)header + header->Strings;
+
+	for(unsigned int i = 0; i < count; i++)
+	{
+		values[i] = NULL;
+
+		if(offsets[i] != DISCOVERY_CACHE_NULL)
+		{
+			size_t size = strlen(strings + offsets[i]) + 1;
+
+			values[i] = rp_malloc(size);
+			if(values[i])
+				memcpy(values[i], strings + offsets[i], size);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadDiscoveryCacheImplStrings(S_ApiImplBuilder *builder, const S_DiscoveryCacheHeader *header, const uint32_t *offsets, unsigned int count, char **values)
+{
+	// values is only written while filling
+	const char *strings = (const char *)header + header->Strings;
+
+	for(unsigned int i = 0; i < count; i++)
+	{
+		const char *value = offsets[i] != DISCOVERY_CACHE_NULL ? strings + offsets[i] : NULL;
+		char *v = rp_ImplAddString(builder, value, value ? strlen(value) : 0);
+
+		if(builder->Impl)
+			values[i] = v;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadDiscoveryCacheApiImpl(S_ApiImplBuilder *builder, const S_DiscoveryCacheHeader *header, const S_DiscoveryCacheImpl *record)
+{
+	const unsigned char *image = (const unsigned char *)header;
+	const S_DiscoveryCacheDevice *devices = (const S_DiscoveryCacheDevice *)(image + header->Devices) + record->FirstDevice;
+	const S_DiscoveryCacheProtocol *protocols = (const S_DiscoveryCacheProtocol *)(image + header->Protocols) + record->FirstProtocol;
+	const uint32_t *deviceIds = (const uint32_t *)(image + header->DeviceIds);
+	S_RP1210ApiImpl *impl = builder->Impl;
+
+	rp_ReadDiscoveryCacheImplStrings(builder, header, &record->Name, 1, impl ? &impl->Name : NULL);
+	rp_ReadDiscoveryCacheImplStrings(builder, header, &record->DriverPath, 1, impl ? &impl->DriverPath : NULL);
+	rp_ReadDiscoveryCacheImplStrings(builder, header, record->Vendor, NUM_VENDOR_FIELDS, impl ? (char **)&impl->VendorInformation : NULL);
+
+	for(uint32_t i = 0; i < record->NumDevices; i++)
+		rp_ReadDiscoveryCacheImplStrings(builder, header, devices[i].Fields, NUM_DEVICE_FIELDS, impl ? (char **)impl->Devices[i] : NULL);
+
+	for(uint32_t i = 0; i < record->NumProtocols; i++)
+	{
+		rp_ReadDiscoveryCacheImplStrings(builder, header, protocols[i].Fields, NUM_PROTOCOL_FIELDS, impl ? (char **)impl->Protocols[i] : NULL);
+
+		if(!impl)
+			builder->Size.NumDeviceIds += protocols[i].NumDeviceIds;
+		else
+		{
+			S_ProtocolDeviceMap *map = impl->ProtocolDeviceMap[i];
+			map->ProtocolId = protocols[i].ProtocolId;
+
+			if(impl->Protocols[i]->Devices)
+			{
+				map->DeviceIds = builder->DeviceIds;
+				for(uint32_t j = 0; j < protocols[i].NumDeviceIds; j++)
+					map->DeviceIds[j] = deviceIds[protocols[i].FirstDeviceId + j];
+
+				map->NumDevices = protocols[i].NumDeviceIds;
+				builder->DeviceIds += map->NumDevices;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_RP1210ApiImpl *rp_ReadDiscoveryCacheImpl(const S_DiscoveryCacheHeader *header, const S_DiscoveryCacheImpl *record)
+{
+	// builds the same block rp_ReadRP1210ImplIni does, measured and filled the same way
+	S_ApiImplBuilder builder;
+	memset(&builder, 0, sizeof(S_ApiImplBuilder));
+
+	builder.Size.NumDevices = record->NumDevices;
+	builder.Size.NumProtocols = record->NumProtocols;
+	rp_ReadDiscoveryCacheApiImpl(&builder, header, record);
+
+	if(rp_CreateApiImpl(&builder))
+	{
+		rp_ReadDiscoveryCacheApiImpl(&builder, header, record);
+		rp_IndexApiImpl(builder.Impl);
+	}
+
+	return builder.Impl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Discovery *rp_ReadDiscoveryCache(const unsigned char *image)
+{
+	const S_DiscoveryCacheHeader *header = (const S_DiscoveryCacheHeader *)image;
+	const S_DiscoveryCacheFile *files = (const S_DiscoveryCacheFile *)(image + header->Files);
+	const S_DiscoveryCacheImpl *impls = (const S_DiscoveryCacheImpl *)(image + header->Impls);
+	const S_DiscoveryCacheLoadErr *loadErrors = (const S_DiscoveryCacheLoadErr *)(image + header->LoadErrors);
+
+	rp_ClearLastError();
+
+	S_Discovery *discovery = rp_mallocZ(sizeof(S_Discovery));
+	if(!discovery)
+		return NULL;
+
+	discovery->RefCount = 1;
+	discovery->CheckedTime = (long)rp_GetTickCount();
+	discovery->Files = rp_mallocZ(header->NumFiles * sizeof(S_DiscoveryFile));
+
+	for(uint32_t i = 0; discovery->Files && i < header->NumFiles; i++)
+	{
+		S_DiscoveryFile *file = &discovery->Files[discovery->NumFiles++];
+
+		rp_ReadDiscoveryCacheStrings(header, &files[i].Path, 1, &file->Path);
+		file->Info.Size = files[i].Size;
+		file->Info.ModifiedTime = files[i].ModifiedTime;
+		file->Info.Device = files[i].Device;
+		file->Info.Inode = files[i].Inode;
+	}
+
+	// an empty list is left NULL, like rp_ReadDiscovery leaves it without any listed implementation
+	S_RP1210ApiImpls *apiImpls = &discovery->Impls;
+	apiImpls->Impls = header->NumImpls ? rp_malloc(header->NumImpls * sizeof(S_RP1210ApiImpl *)) : NULL;
+	apiImpls->LoadErrors = header->NumLoadErrors ? rp_mallocZ(header->NumLoadErrors * sizeof(S_RP1210ImplLoadErr *)) : NULL;
 
-		} while((tok = rp_strtok(NULL, sectionDelim, &tokContext)));
+	for(uint32_t i = 0; apiImpls->Impls && i < header->NumImpls; i++)
+	{
+		S_RP1210ApiImpl *impl = rp_ReadDiscoveryCacheImpl(header, &impls[i]);
+		if(impl)
+			apiImpls->Impls[apiImpls->NumImpls++] = impl;
 	}
 
-	rp_free(tokPtr);
+	for(uint32_t i = 0; apiImpls->LoadErrors && i < header->NumLoadErrors; i++)
+	{
+		S_RP1210ImplLoadErr *le = rp_mallocZ(sizeof(S_RP1210ImplLoadErr));
+		if(le)
+		{
+			rp_ReadDiscoveryCacheStrings(header, &loadErrors[i].ImplName, 1, &le->ImplName);
+			rp_ReadDiscoveryCacheStrings(header, &loadErrors[i].Description, 1, &le->Description);
+			le->Error = (ORP_ERR)loadErrors[i].Error;
+			apiImpls->LoadErrors[apiImpls->NumLoadErrors++] = le;
+		}
+	}
 
-	if(rpGetLastError() == ORP_ERR_INI_KEYNOTFOUND)
-		rp_ClearLastError();
-}
+	rp_IndexDiscovery(discovery);
 
-/////////////////////////////////////////////////////////////////////////////////
-///
-///
-/////////////////////////////////////////////////////////////////////////////////
-void rp_EnumValidDeviceCallback(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, unsigned int sectionIndex, const char *iniSectionName)
-{
-	impl->NumDevices++;
+	// any allocation failure above set the last error
+	if(rpGetLastError() != ORP_ERR_NO_ERROR)
+	{
+		rp_DestroyDiscovery(discovery);
+		discovery = NULL;
+	}
+
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_EnumCreateDeviceCallback(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, unsigned int sectionIndex, const char *iniSectionName)
+S_Discovery *rp_LoadDiscoveryCache(void)
 {
-	S_RP1210DeviceInformation *devInfo = rp_malloc(sizeof(S_RP1210DeviceInformation));
-	
-	if(devInfo)
+	// a missing, stale or damaged cache isn't an error, the INI files are read instead
+	S_Discovery *discovery = NULL;
+	char *iniPath = NULL;
+	char *cachePath = NULL;
+
+	if(rp_GetRp1210IniPath(&iniPath, "%s%s", RP1210_HOME_SUBDIR, RP1210_ININAME) == ORP_ERR_NO_ERROR)
 	{
-		devInfo->DeviceDescription = rp_ReadRP1210IniKey(hIni, iniSectionName, "DeviceDescription");
-		devInfo->DeviceID = rp_ReadRP1210IniKey(hIni, iniSectionName, "DeviceId");
-		devInfo->DeviceName = rp_ReadRP1210IniKey(hIni, iniSectionName, "DeviceName");
-		devInfo->DeviceParams = rp_ReadRP1210IniKey(hIni, iniSectionName, "DeviceParams");
+		if(rp_GetRp1210IniPath(&cachePath, "%s%s", RP1210_HOME_SUBDIR, DISCOVERY_CACHE_NAME) == ORP_ERR_NO_ERROR)
+		{
+			ORP_HANDLE hMap = rp_MapFile(cachePath);
+
+			if(hMap)
+			{
+				uint64_t imageSize = 0;
+				const unsigned char *image = rp_GetMappedFileData(hMap, &imageSize);
+
+				if(rp_ValidateDiscoveryCache(image, imageSize) && rp_DiscoveryCacheCurrent(image, iniPath))
+					discovery = rp_ReadDiscoveryCache(image);
+
+				rpFreeHandle(hMap);
+			}
 
-		devInfo->MultiCANChannels = rp_ReadRP1210IniKey(hIni, iniSectionName, "MultiCANChannels");
-		devInfo->MultiISO15765Channels = rp_ReadRP1210IniKey(hIni, iniSectionName, "MultiISO15765Channels");
-		devInfo->MultiJ1939Channels = rp_ReadRP1210IniKey(hIni, iniSectionName, "MultiJ1939Channels");
+			rp_free(cachePath);
+		}
 
-		impl->Devices[sectionIndex] = devInfo;
+		rp_free(iniPath);
 	}
-}
 
-/////////////////////////////////////////////////////////////////////////////////
-///
-///
-/////////////////////////////////////////////////////////////////////////////////
-void rp_EnumValidProtocolCallback(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, unsigned int sectionIndex, const char *iniSectionName)
-{
-	impl->NumProtocols++;
+	rp_ClearLastError();
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_EnumCreateProtocolCallback(ORP_HANDLE hIni, S_RP1210ApiImpl *impl, unsigned int sectionIndex, const char *iniSectionName)
+S_Discovery *rp_ReadLazyDiscovery(void)
 {
-	if(sectionIndex < impl->NumProtocols)
+	// only the implementation list is read, rp_LoadLazyImpl reads a vendor INI when it's first used
+	S_Discovery *discovery = rp_mallocZ(sizeof(S_Discovery));
+	if(!discovery)
+		return NULL;
+
+	discovery->RefCount = 1;
+	discovery->CheckedTime = (long)rp_GetTickCount();
+
+	S_DiscoveryFile iniFile = { 0 };
+	char *rp1210IniImpls = NULL;
+	ORP_ERR r = rp_ReadRP1210Ini(&rp1210IniImpls, &iniFile);
+
+	if(!ORP_IS_ERR(r))
 	{
-		S_RP1210ProtocolInformation *protoInfo = rp_malloc(sizeof(S_RP1210ProtocolInformation));
+		const char delim[] = ",";
+		unsigned short maxImpls = rp_GetRP1210ImplMax(rp1210IniImpls, delim);
+		S_RP1210ApiImpls *impls = &discovery->Impls;
 
-		if(protoInfo)
+		discovery->Files = rp_mallocZ((maxImpls + 1) * sizeof(S_DiscoveryFile));
+		if(discovery->Files)
 		{
-			protoInfo->ProtocolDescription = rp_ReadRP1210IniKey(hIni, iniSectionName, "ProtocolDescription");
-			protoInfo->ProtocolSpeed = rp_ReadRP1210IniKey(hIni, iniSectionName, "ProtocolSpeed");
-			protoInfo->ProtocolString = rp_ReadRP1210IniKey(hIni, iniSectionName, "ProtocolString");
-			protoInfo->ProtocolParams = rp_ReadRP1210IniKey(hIni, iniSectionName, "ProtocolParams");
-			protoInfo->Devices = rp_ReadRP1210IniKey(hIni, iniSectionName, "Devices");
+			discovery->Files[0] = iniFile;
+			discovery->NumFiles = 1;
+			iniFile.Path = NULL;
+
+			if(maxImpls > 0)
+			{
+				discovery->LazyImpls = rp_mallocZ(maxImpls * sizeof(S_LazyImpl));
+				impls->Impls = rp_mallocZ(maxImpls * sizeof(S_RP1210ApiImpl *));
+				impls->LoadErrors = rp_mallocZ(maxImpls * sizeof(S_RP1210ImplLoadErr *));
+			}
+		}
 
-			impl->Protocols[sectionIndex] = protoInfo;
+		if(discovery->LazyImpls && impls->Impls && impls->LoadErrors)
+		{
+			char *tokContext = NULL;
+			char *tok = rp_strtok(rp1210IniImpls, delim, &tokContext);
 
-			impl->ProtocolDeviceMap[sectionIndex] = rp_malloc(sizeof(S_ProtocolDeviceMap));
-			if(impl->ProtocolDeviceMap[sectionIndex])
+			while(tok != NULL)
 			{
-				impl->ProtocolDeviceMap[sectionIndex]->ProtocolId = sectionIndex;
-				impl->ProtocolDeviceMap[sectionIndex]->Protocol = protoInfo;
-				impl->ProtocolDeviceMap[sectionIndex]->NumDevices = 0;
-				impl->ProtocolDeviceMap[sectionIndex]->DeviceIds = NULL;
+				assert(impls->NumImpls < maxImpls); // shouldn't happen, but still....
 
-				if(protoInfo->Devices)
-				{
-					const char *devDelim = ",";
-					unsigned short devCount = 0;
-					impl->ProtocolDeviceMap[sectionIndex]->DeviceIds = rp_malloc(impl->NumDevices * sizeof(unsigned int));
+				S_LazyImpl *lazy = &discovery->LazyImpls[impls->NumImpls];
+				lazy->Name = rp_malloc(strlen(tok) + 1);
+				if(!lazy->Name)
+					break;
 
-					if(!impl->ProtocolDeviceMap[sectionIndex]->DeviceIds)
-						rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
-					else
-					{
-						char *tokContext = NULL;
-						char *tokPtr = rp_malloc(strlen(protoInfo->Devices) + 1);
-						char *tok = tokPtr;
-
-						if(tok)
-						{
-							strcpy(tok, protoInfo->Devices);
-							tok = rp_strtok(tok, devDelim, &tokContext);
-						}
-						else
-							rp_SetLastError(ORP_ERR_MEM_ALLOC, "");
-
-						if(tok)
-						{
-							do
-							{
-								long devId = rp_strtol(tok);
-								if(rpGetLastError() != ORP_ERR_NO_ERROR)
-									continue;
-								else
-								{
-									if(devId >= 0 && devId <= UINT32_MAX && devCount < impl->NumDevices)
-										impl->ProtocolDeviceMap[sectionIndex]->DeviceIds[devCount++] = (int)devId;
-									else
-										continue;
-								}
-
-							} while((tok = rp_strtok(NULL, devDelim, &tokContext)));
-						}
-
-						rp_free(tokPtr);
-					}
+				strcpy(lazy->Name, tok);
+				impls->NumImpls++;
 
-					impl->ProtocolDeviceMap[sectionIndex]->NumDevices = devCount;
-				}
+				tok = rp_strtok(NULL, delim, &tokContext);
 			}
+
+			discovery->NumFiles += impls->NumImpls; // filled in as the implementations are loaded
 		}
+
+		rp_IndexDiscovery(discovery);
+
+		// any allocation failure above set the last error
+		r = rpGetLastError();
+		rp_free(rp1210IniImpls);
 	}
-	else
-		rp_SetLastError(ORP_ERR_BAD_RANGE, NULL);
+
+	rp_free(iniFile.Path);
+
+	if(ORP_IS_ERR(r))
+	{
+		rp_DestroyDiscovery(discovery);
+		discovery = NULL;
+	}
+
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_ReadDevices(ORP_HANDLE hIni, S_RP1210ApiImpl *impl)
+S_RP1210ApiImpl *rp_LoadLazyImpl(S_Discovery *discovery, unsigned int index)
 {
-	const char *devDelim = ",";
-	char *devNamePrefix = "DeviceInformation";
-
-	rp_EnumIniSections(hIni, impl, impl->VendorInformation.Devices, devDelim, devNamePrefix, rp_EnumValidDeviceCallback);
+	S_LazyImpl *lazy = &discovery->LazyImpls[index];
+	S_RP1210ApiImpls *impls = &discovery->Impls;
 
-	if(rpGetLastError() == ORP_ERR_NO_ERROR)
+	if(!rp_AtomicLoad(&lazy->Loaded))
 	{
-		impl->Devices = rp_malloc(impl->NumDevices * sizeof(S_RP1210DeviceInformation *));
+		// read without holding the lock, if another thread loads the same implementation first its result is kept.
+		// A failure that couldn't be recorded in a load error leaves the implementation to be tried again
+		S_DiscoveryFile file = { 0 };
+		S_RP1210ImplLoadErr *loadError = NULL;
+		S_RP1210ApiImpl *impl = rp_CreateRP1210Impl(lazy->Name, &loadError, &file);
 
-		if(impl->Devices)
+		if(impl || loadError)
 		{
-			memset(impl->Devices, 0, impl->NumDevices * sizeof(S_RP1210DeviceInformation *));
-			rp_EnumIniSections(hIni, impl, impl->VendorInformation.Devices, devDelim, devNamePrefix, rp_EnumCreateDeviceCallback);
+			rp_SpinLock(&discovery->LoadLock);
+
+			if(!lazy->Loaded)
+			{
+				discovery->Files[index + 1] = file;
+				impls->Impls[index] = impl;
+				lazy->LoadError = loadError;
+
+				if(loadError)
+					impls->LoadErrors[impls->NumLoadErrors++] = loadError;
+
+				rp_AtomicStore(&lazy->Loaded, 1);
+
+				file.Path = NULL;
+				impl = NULL;
+				loadError = NULL;
+			}
+
+			rp_SpinUnlock(&discovery->LoadLock);
 		}
+
+		if(impl)
+			rp_DestroyApiImpl(impl);
+		if(loadError)
+			rp_DestroyLoaderError(loadError);
+
+		rp_free(file.Path);
 	}
+
+	S_RP1210ApiImpl *impl = NULL;
+
+	if(rp_AtomicLoad(&lazy->Loaded))
+	{
+		impl = impls->Impls[index];
+		if(!impl)
+			rp_SetLastError(lazy->LoadError->Error, " Implementation = %s.", lazy->Name);
+	}
+
+	return impl;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_ReadProtocols(ORP_HANDLE hIni, S_RP1210ApiImpl *impl)
+S_Discovery *rp_CreateDiscovery(bool lazy)
 {
-	const char *devDelim = ",";
-	char *devNamePrefix = "ProtocolInformation";
+	// a lazy discovery reads next to nothing up front, the on-disk cache only holds fully read discoveries
+	if(lazy)
+		return rp_ReadLazyDiscovery();
 
-	rp_EnumIniSections(hIni, impl, impl->VendorInformation.Protocols, devDelim, devNamePrefix, rp_EnumValidProtocolCallback);
+	// a new process starts from the on-disk cache when it's still current,
+	// after rpRefreshApiImpls the INI files are read regardless and the cache rewritten
+	S_Discovery *discovery = rp_AtomicLoad(&gDiscoveryCacheStale) ? NULL : rp_LoadDiscoveryCache();
 
-	if(rpGetLastError() == ORP_ERR_NO_ERROR)
+	if(!discovery)
 	{
-		impl->ProtocolDeviceMap = rp_malloc(impl->NumProtocols * sizeof(S_ProtocolDeviceMap *));
-
-		if(impl->ProtocolDeviceMap)
-		{
-			memset(impl->ProtocolDeviceMap, 0, impl->NumProtocols * sizeof(S_ProtocolDeviceMap *));
-			impl->Protocols = rp_malloc(impl->NumProtocols * sizeof(S_RP1210ProtocolInformation *));
+		rp_AtomicStore(&gDiscoveryCacheStale, 0);
+		discovery = rp_ReadDiscovery();
 
-			if(impl->Protocols)
-			{
-				memset(impl->Protocols, 0, impl->NumProtocols * sizeof(S_RP1210ProtocolInformation *));
-				rp_EnumIniSections(hIni, impl, impl->VendorInformation.Protocols, devDelim, devNamePrefix, rp_EnumCreateProtocolCallback);
-			}
-		}
+		// only a discovery read without errors is worth keeping, a failed allocation may have left it incomplete
+		if(discovery && rpGetLastError() == ORP_ERR_NO_ERROR)
+			rp_SaveDiscoveryCache(discovery);
 	}
+
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_RP1210ApiImpl *rp_ReadRP1210ImplIni(const char *implName)
+bool rp_DiscoveryChanged(S_Discovery *discovery)
 {
-	S_RP1210ApiImpl *impl = NULL;
-	char *implPath = NULL;
-	ORP_ERR r = rp_GetRp1210IniPath(&implPath, "%s%s%s", RP1210_HOME_SUBDIR, implName, ".ini");
+	// the files are checked at most once per interval, in between the discovery is trusted as is
+	unsigned long now = (unsigned long)rp_GetTickCount();
+	unsigned long checked = (unsigned long)rp_AtomicLoad(&discovery->CheckedTime);
+	bool changed = false;
 
-	if(!ORP_IS_ERR(r))
+	if(now - checked >= DISCOVERY_CHECK_INTERVAL)
 	{
-		ORP_HANDLE hIni = rp_IniOpen(implPath, NULL);
-		if(hIni)
+		rp_AtomicStore(&discovery->CheckedTime, (long)now);
+
+		for(unsigned int i = 0; i < discovery->NumFiles && !changed; i++)
 		{
-			impl = rp_mallocZ(sizeof(S_RP1210ApiImpl));
-			if(impl)
-			{
-				impl->Name = rp_mallocZ(strlen(implName) + 1);
-				if(impl->Name)
-				{
-					strcpy(impl->Name, implName);
-					rp_GetRp1210DriverPath(true, &impl->DriverPath, "%s%s%s.%s", RP1210_HOME_SUBDIR, RP1210_DRIVER_SUBDIR, implName, RP1210_DRIVER_EXT);
-				}
-			}
+			// a lazy discovery's vendor INI is only known once its implementation has been loaded
+			if(i > 0 && discovery->LazyImpls && !rp_AtomicLoad(&discovery->LazyImpls[i - 1].Loaded))
+				continue;
 
-			if(rpGetLastError() != ORP_ERR_NO_ERROR)
-			{
-				rp_DestroyApiImpl(impl);
-				impl = NULL;
-			}
-			else if(impl)
+			S_DiscoveryFile file = discovery->Files[i];
+
+			if(file.Path)
 			{
-				rp_ReadVendorInformation(hIni, &impl->VendorInformation);
-				rp_ReadDevices(hIni, impl);
-				rp_ReadProtocols(hIni, impl);
+				rp_StatDiscoveryFile(&file);
+				changed = memcmp(&file.Info, &discovery->Files[i].Info, sizeof(S_FileInfo)) != 0;
 			}
-
-			rpFreeHandle(hIni);
 		}
-
-		rp_free(implPath);
 	}
 
-	return impl;
+	return changed;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_RP1210ApiImpl *rp_CreateRP1210Impl(const char *implName, S_RP1210ImplLoadErr **loadError)
+S_Discovery *rp_AcquireDiscovery(S_Discovery **cache)
 {
-	S_RP1210ApiImpl *impl = rp_ReadRP1210ImplIni(implName);
-
-	if(!impl && loadError)
-	{
-		// save error generated in rp_ReadRP1210ImplIni
-		// if unable to save it, retain last error in rpGetLastError from rp_ReadRP1210ImplIni
-		// this means errors below will be swallowed (only failures below are malloc fails anyway)
-		S_RP1210ImplLoadErr *le = rp_malloc(sizeof(S_RP1210ImplLoadErr));
-		if(le)
-		{
-			memset(le, 0, sizeof(S_RP1210ImplLoadErr));
-			const char *e = rpGetLastErrorDesc();
-
-			le->Description = rp_malloc(strlen(e) + 1);
-			if(le->Description)
-			{
-				le->ImplName = rp_malloc(strlen(implName) + 1);
-				if(le->ImplName)
-				{
-					le->Error = rpGetLastError();
-
-					strcpy(le->Description, e);
-					strcpy(le->ImplName, implName);
+	rp_SpinLock(&gDiscoveryLock);
 
-					rp_SetLastError(ORP_ERR_NO_ERROR, NULL);
-				}
-			}
+	S_Discovery *discovery = *cache;
+	if(discovery)
+		rp_AtomicIncrement(&discovery->RefCount);
 
-			if(rpGetLastError() != ORP_ERR_NO_ERROR)
-				rp_DestroyLoaderError(le);
-			else
-				*loadError = le;
-		}
-	}
+	rp_SpinUnlock(&gDiscoveryLock);
 
-	return impl;
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_FreeApiImpls(ORP_HANDLE hImpls)
+S_Discovery *rp_InstallDiscovery(S_Discovery **cache, S_Discovery *expected, S_Discovery *discovery)
 {
-	S_RP1210ApiImpls *impls = rp_HandleToTarget(hImpls);
+	// replaces the cached discovery if it's still the one the caller found stale (or there's none),
+	// if another thread already replaced it that one is used and discovery is dropped
+	S_Discovery *unused;
 
-	if(impls->Impls)
-		for(int i = 0; i < impls->NumImpls; i++)
-			rp_DestroyApiImpl(impls->Impls[i]);
+	rp_SpinLock(&gDiscoveryLock);
 
-	if(impls->LoadErrors)
-		for(int i = 0; i < impls->NumLoadErrors; i++)
-			rp_DestroyLoaderError(impls->LoadErrors[i]);
+	if(*cache == expected || !*cache)
+	{
+		unused = *cache;
+		*cache = discovery;
+	}
+	else
+	{
+		unused = discovery;
+		discovery = *cache;
+	}
 
-	rp_free(impls->LoadErrors);
-	rp_free(impls->Impls);
+	rp_AtomicIncrement(&discovery->RefCount);
+	rp_SpinUnlock(&gDiscoveryLock);
+
+	if(unused)
+		rp_ReleaseDiscovery(unused);
 
-	memset(impls, 0, sizeof(S_RP1210ApiImpls));
+	return discovery;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-ORP_HANDLE rpGetApiImpls(void)
+ORP_HANDLE rp_GetApiImpls(bool lazy)
 {
 	rp_ClearLastError();
 
-	S_RP1210ApiImpls impls;
-	memset(&impls, 0, sizeof(impls));
-
-	char *rp1210IniImpls = NULL;
-	ORP_ERR r = rp_ReadRP1210Ini(&rp1210IniImpls);
+	ORP_HANDLE hImpls = NULL;
+	S_Discovery **cache = lazy ? &gLazyDiscovery : &gDiscovery;
+	S_Discovery *cached = rp_AcquireDiscovery(cache);
+	S_Discovery *discovery = cached;
 
-	if(!ORP_IS_ERR(r))
+	if(!cached || rp_DiscoveryChanged(cached))
 	{
-		const char delim[] = ",";
-		unsigned short numImpls = 0;
-		unsigned short numLoadErrs = 0;
-		unsigned short maxImpls = rp_GetRP1210ImplMax(rp1210IniImpls, delim);
+		// a failed rebuild is reported to the caller, the cached discovery stays until a rebuild succeeds
+		S_Discovery *created = rp_CreateDiscovery(lazy);
+		discovery = created ? rp_InstallDiscovery(cache, cached, created) : NULL;
 
-		if(maxImpls > 0)
-		{
-			S_RP1210ApiImpl **localImpls = rp_malloc(maxImpls * sizeof(S_RP1210ApiImpl *));
-			S_RP1210ImplLoadErr **loadErrors = rp_malloc(maxImpls * sizeof(S_RP1210ImplLoadErr *));
-			if(localImpls && loadErrors)
-			{
-				char *tok = rp1210IniImpls;
-				char *tokContext = NULL;
+		if(cached)
+			rp_ReleaseDiscovery(cached);
+	}
 
-				tok = rp_strtok(tok, delim, &tokContext);
-				while(tok != NULL)
-				{
-					assert(numImpls < maxImpls && numLoadErrs < maxImpls); // shouldn't happen, but still....
+	if(discovery)
+	{
+		hImpls = rp_CreateHandle(discovery, rp_FreeApiImpls);
+		if(!hImpls)
+			rp_ReleaseDiscovery(discovery);
+	}
 
-					S_RP1210ApiImpl *impl = rp_CreateRP1210Impl(tok, &loadErrors[numLoadErrs]);
-					if(impl)
-						localImpls[numImpls++] = impl;
-					else if(loadErrors[numLoadErrs])
-						numLoadErrs++;
+	return hImpls;
+}
 
-					tok = rp_strtok(NULL, delim, &tokContext);
-				}
-			}
-			else
-				r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rpGetApiImpls(void)
+{
+	return rp_GetApiImpls(false);
+}
 
-			if(!ORP_IS_ERR(r))
-				rp_InitApiImpls(&impls, localImpls, numImpls, loadErrors, numLoadErrs);
-			else
-			{
-				if(localImpls)
-					for(int i = 0; i < numImpls; i++)
-						rp_DestroyApiImpl(localImpls[i]);
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rpGetApiImplsLazy(void)
+{
+	return rp_GetApiImpls(true);
+}
 
-				if(loadErrors)
-					for(int i = 0; i < numImpls; i++)
-						rp_DestroyLoaderError(loadErrors[i]);
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rpRefreshApiImpls(void)
+{
+	rp_ClearLastError();
+	rp_SpinLock(&gDiscoveryLock);
 
-				rp_free(localImpls);
-				rp_free(loadErrors);
-			}
-		}
-		else
-			rp_InitApiImpls(&impls, NULL, 0, NULL, 0);
+	S_Discovery *discovery = gDiscovery;
+	S_Discovery *lazyDiscovery = gLazyDiscovery;
+	gDiscovery = NULL;
+	gLazyDiscovery = NULL;
+	rp_AtomicStore(&gDiscoveryCacheStale, 1);
 
-		rp_free(rp1210IniImpls);
-	}
+	rp_SpinUnlock(&gDiscoveryLock);
 
-	return r == ORP_ERR_NO_ERROR ? rp_CopyToHandle(&impls, sizeof(impls), rp_FreeApiImpls) : NULL;
+	if(discovery)
+		rp_ReleaseDiscovery(discovery);
+	if(lazyDiscovery)
+		rp_ReleaseDiscovery(lazyDiscovery);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -920,7 +2378,16 @@ unsigned int rpGetNumApiImplLoadErrors(ORP_HANDLE hImpls)
 	assert(hImpls != NULL);
 
 	rp_ClearLastError();
-	return ((S_RP1210ApiImpls *)rp_HandleToTarget(hImpls))->NumLoadErrors;
+
+	S_Discovery *discovery = rp_HandleToTarget(hImpls);
+	unsigned int numLoadErrors;
+
+	// a lazy discovery gains load errors as its implementations are loaded
+	rp_SpinLock(&discovery->LoadLock);
+	numLoadErrors = discovery->Impls.NumLoadErrors;
+	rp_SpinUnlock(&discovery->LoadLock);
+
+	return numLoadErrors;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -934,11 +2401,17 @@ S_RP1210ImplLoadErr *rpGetApiImplLoadError(ORP_HANDLE hImpls, unsigned int index
 	rp_ClearLastError();
 
 	S_RP1210ImplLoadErr *le = NULL;
-	S_RP1210ApiImpls *impls = rp_HandleToTarget(hImpls);
+	S_Discovery *discovery = rp_HandleToTarget(hImpls);
+	S_RP1210ApiImpls *impls = &discovery->Impls;
+
+	rp_SpinLock(&discovery->LoadLock);
 
 	if(index < impls->NumLoadErrors)
 		le = impls->LoadErrors[index];
-	else
+
+	rp_SpinUnlock(&discovery->LoadLock);
+
+	if(!le)
 		rp_SetLastError(ORP_ERR_BAD_ARG, NULL);
 
 	return le;
@@ -955,10 +2428,15 @@ ORP_HANDLE rpGetApiImpl(ORP_HANDLE hImpls, unsigned int index)
 	rp_ClearLastError();
 
 	ORP_HANDLE hImpl = NULL;
-	S_RP1210ApiImpls *impls = rp_HandleToTarget(hImpls);
+	S_Discovery *discovery = rp_HandleToTarget(hImpls);
+	S_RP1210ApiImpls *impls = &discovery->Impls;
 
 	if(index < impls->NumImpls)
-		hImpl = rp_CreateHandle(impls->Impls[index], NULL);
+	{
+		S_RP1210ApiImpl *impl = discovery->LazyImpls ? rp_LoadLazyImpl(discovery, index) : impls->Impls[index];
+		if(impl)
+			hImpl = rp_CreateHandle(impl, NULL);
+	}
 	else
 		rp_SetLastError(ORP_ERR_BAD_ARG, NULL);
 
@@ -977,13 +2455,18 @@ ORP_HANDLE rpGetApiImplByName(ORP_HANDLE hImpls, const char *name)
 	rp_ClearLastError();
 
 	ORP_HANDLE hImpl = NULL;
-	S_RP1210ApiImpls *impls = rp_HandleToTarget(hImpls);
+	S_Discovery *discovery = rp_HandleToTarget(hImpls);
+	const S_LookupIndex *index = &discovery->ImplIndex;
 
-	for(int i = 0; i < impls->NumImpls; i++)
+	for(uint32_t i = rp_HashName(name) & index->Mask; index->Slots[i]; i = (i + 1) & index->Mask)
 	{
-		if(strcmp(name, impls->Impls[i]->Name) == 0)
+		unsigned int implIndex = index->Slots[i] - 1;
+
+		if(strcmp(name, rp_DiscoveryImplName(discovery, implIndex)) == 0)
 		{
-			hImpl = rp_CreateHandle(impls->Impls[i], NULL);
+			S_RP1210ApiImpl *impl = discovery->LazyImpls ? rp_LoadLazyImpl(discovery, implIndex) : discovery->Impls.Impls[implIndex];
+			if(impl)
+				hImpl = rp_CreateHandle(impl, NULL);
 			break;
 		}
 	}
@@ -1071,15 +2554,19 @@ S_RP1210DeviceInformation *rpGetDeviceInfoByName(ORP_HANDLE hImpl, const char *n
 	rp_ClearLastError();
 	S_RP1210DeviceInformation *devInfo = NULL;
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
+	const S_LookupIndex *index = &impl->DeviceNameIndex;
 
+	// devices with the same name are found in device order
 	unsigned char devCount = 0;
-	for(unsigned int i = 0; i < impl->NumDevices; i++)
+	for(uint32_t i = rp_HashName(name) & index->Mask; index->Slots[i]; i = (i + 1) & index->Mask)
 	{
-		if(strcmp(impl->Devices[i]->DeviceName, name) == 0)
+		S_RP1210DeviceInformation *d = impl->Devices[index->Slots[i] - 1];
+
+		if(strcmp(d->DeviceName, name) == 0)
 		{
 			if(devCount == deviceIndex)
 			{
-				devInfo = impl->Devices[i];
+				devInfo = d;
 				break;
 			}
 			else
@@ -1102,15 +2589,9 @@ S_RP1210DeviceInformation *rpGetDeviceInfoById(ORP_HANDLE hImpl, unsigned int de
 	S_RP1210DeviceInformation *devInfo = NULL;
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
 
-	for(unsigned int i = 0; i < impl->NumDevices; i++)
-	{
-		unsigned int devId = rp_strtol(impl->Devices[i]->DeviceID);
-		if(rpGetLastError() == ORP_ERR_NO_ERROR && devId == deviceId)
-		{
-			devInfo = impl->Devices[i];
-			break;
-		}
-	}
+	int i = rp_FindDeviceById(impl, deviceId);
+	if(i >= 0)
+		devInfo = impl->Devices[i];
 
 	return devInfo;
 }
@@ -1148,31 +2629,16 @@ ORP_ERR rpGetDevicesByProtocol(ORP_HANDLE hImpl, const char *protocol, S_RP1210D
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
 
 	unsigned int actualNumDevices = 0;
-	unsigned int protocolId = 0;
-	bool foundProto = false;
-
-	for(unsigned int i = 0; i < impl->NumProtocols; i++)
-	{
-		if(strcmp(impl->ProtocolDeviceMap[i]->Protocol->ProtocolString, protocol) == 0)
-		{
-			protocolId = impl->ProtocolDeviceMap[i]->ProtocolId;
-			foundProto = true;
-			break;
-		}
-	}
+	int protocolId = rp_FindProtocol(impl, protocol);
 
-	if(foundProto)
+	if(protocolId >= 0)
 	{
-		for(unsigned int i = 0; i < impl->ProtocolDeviceMap[protocolId]->NumDevices; i++)
+		for(unsigned int i = impl->ProtocolDeviceStart[protocolId]; i < impl->ProtocolDeviceStart[protocolId + 1]; i++)
 		{
-			S_RP1210DeviceInformation *dev = rpGetDeviceInfoById(hImpl, impl->ProtocolDeviceMap[protocolId]->DeviceIds[i]);
-			if(dev)
-			{
-				if(devices && actualNumDevices < *numDevices)
-					devices[actualNumDevices++] = dev;
-				else if(!devices)
-					actualNumDevices++;
-			}
+			if(devices && actualNumDevices < *numDevices)
+				devices[actualNumDevices++] = impl->Devices[impl->ProtocolDevices[i]];
+			else if(!devices)
+				actualNumDevices++;
 		}
 	}
 
@@ -1227,14 +2693,9 @@ S_RP1210ProtocolInformation *rpGetProtocolInfoByName(ORP_HANDLE hImpl, const cha
 	S_RP1210ProtocolInformation *protoInfo = NULL;
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
 
-	for(unsigned int i = 0; i < impl->NumProtocols; i++)
-	{
-		if(strcmp(impl->Protocols[i]->ProtocolString, name) == 0)
-		{
-			protoInfo = impl->Protocols[i];
-			break;
-		}
-	}
+	int i = rp_FindProtocol(impl, name);
+	if(i >= 0)
+		protoInfo = impl->Protocols[i];
 
 	return protoInfo;
 }
@@ -1251,14 +2712,9 @@ S_RP1210ProtocolInformation *rpGetProtocolInfoById(ORP_HANDLE hImpl, unsigned in
 	S_RP1210ProtocolInformation *protoInfo = NULL;
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
 
-	for(unsigned int i = 0; i < impl->NumProtocols; i++)
-	{
-		if(impl->ProtocolDeviceMap[i]->ProtocolId == id)
-		{
-			protoInfo = impl->ProtocolDeviceMap[i]->Protocol;
-			break;
-		}
-	}
+	// protocol IDs are assigned densely in protocol order, the map array is its own index
+	if(id < impl->NumProtocols && impl->ProtocolDeviceMap[id]->ProtocolId == id)
+		protoInfo = impl->ProtocolDeviceMap[id]->Protocol;
 
 	return protoInfo;
 }
@@ -1277,21 +2733,20 @@ ORP_ERR rpGetProtocolInfoByDevice(ORP_HANDLE hImpl, S_RP1210DeviceInformation *d
 	S_RP1210ApiImpl *impl = rp_HandleToTarget(hImpl);
 	unsigned int actualNumProtocols = 0;
 
-	unsigned int devId = rp_strtol(deviceInfo->DeviceID);
-	if(rpGetLastError() == ORP_ERR_NO_ERROR)
+	unsigned int devId = deviceInfo->DeviceID ? rp_strtol(deviceInfo->DeviceID) : 0;
+	if(deviceInfo->DeviceID && rpGetLastError() == ORP_ERR_NO_ERROR)
 	{
-		for(unsigned int i = 0; i < impl->NumProtocols; i++)
+		// devices sharing an ID share the protocols listing it, the first one holds the list
+		int d = rp_FindDeviceById(impl, devId);
+
+		if(d >= 0)
 		{
-			for(unsigned int j = 0; j < impl->ProtocolDeviceMap[i]->DeviceIds[j]; j++)
+			for(unsigned int i = impl->DeviceProtocolStart[d]; i < impl->DeviceProtocolStart[d + 1]; i++)
 			{
-				if(impl->ProtocolDeviceMap[i]->DeviceIds[j] == devId)
-				{
-					if(protocols && actualNumProtocols < *numProtocols)
-						protocols[actualNumProtocols++] = impl->ProtocolDeviceMap[i]->Protocol;
-					else if(!protocols)
-						actualNumProtocols++;
-					break;
-				}
+				if(protocols && actualNumProtocols < *numProtocols)
+					protocols[actualNumProtocols++] = impl->Protocols[impl->DeviceProtocols[i]];
+				else if(!protocols)
+					actualNumProtocols++;
 			}
 		}
 
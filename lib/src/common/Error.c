@@ -7,6 +7,7 @@
 #include "OpenRP1210/platform/Platform.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 #define MAX_ERROR_LEN 512
 #define _ERR_MAX -(ORP_ERR_LENGTH - 1)
@@ -33,6 +34,7 @@ const char gErrorText[_ERR_MAX][MAX_ERROR_LEN] =
 
 TLS int gLastError;
 TLS char gLastErrorText[MAX_ERROR_LEN] = _NO_ERR_TXT;
+TLS bool gLastErrorCleared = true; // gLastErrorText is exactly _NO_ERR_TXT
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
@@ -84,6 +86,10 @@ unsigned long rp_errSetText(ORP_ERR error, const char *msg, va_list *args)
 /////////////////////////////////////////////////////////////////////////////////
 ORP_ERR rp_ClearLastError(void)
 {
+	// every API call clears the last error, only format the text when there's something to clear
+	if(gLastError == ORP_ERR_NO_ERROR && gLastErrorCleared)
+		return ORP_ERR_NO_ERROR;
+
 	return rp_SetLastError(ORP_ERR_NO_ERROR, "");
 }
 
@@ -95,6 +101,7 @@ ORP_ERR rp_SetLastErrorVA(ORP_ERR error, const char *msg, va_list *args)
 {
 	gLastError = error;
 	rp_errSetText(error, msg, args);
+	gLastErrorCleared = error == ORP_ERR_NO_ERROR && strcmp(gLastErrorText, _NO_ERR_TXT) == 0;
 
 	return error;
 }
@@ -114,6 +121,23 @@ ORP_ERR rp_SetLastError(ORP_ERR error, const char *msg, ...)
 	return error;
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_RestoreLastError(ORP_ERR error, const char *desc)
+{
+	// desc is a complete description, e.g. from rpGetLastErrorDesc on another thread, it isn't prefixed again
+	if(!desc)
+		return rp_SetLastError(error, NULL);
+
+	gLastError = error;
+	snprintf(gLastErrorText, MAX_ERROR_LEN, "%s", desc);
+	gLastErrorCleared = error == ORP_ERR_NO_ERROR && strcmp(gLastErrorText, _NO_ERR_TXT) == 0;
+
+	return error;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -127,6 +151,8 @@ void rp_AppendLastError(const char *msg, ...)
 	if(sz < MAX_ERROR_LEN)
 		vsnprintf(gLastErrorText + sz, MAX_ERROR_LEN - sz, msg, args);
 
+	gLastErrorCleared = false;
+
 	va_end(args);
 }
 
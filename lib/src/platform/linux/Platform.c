@@ -11,7 +11,13 @@
 #include <assert.h>
 #include <errno.h>
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 
 static const char  gSYS_HOME_DIR[] = "/";
 static const int gSYS_HOME_DIR_LEN = sizeof(gSYS_HOME_DIR) / sizeof(gSYS_HOME_DIR[0]);
@@ -19,6 +25,19 @@ static const int gSYS_HOME_DIR_LEN = sizeof(gSYS_HOME_DIR) / sizeof(gSYS_HOME_DI
 static const char  gSYS_DIR[] = "/";
 static const int gSYS_DIR_LEN = sizeof(gSYS_DIR) / sizeof(gSYS_DIR[0]);
 
+typedef struct S_MappedFile_t
+{
+    void *Data;
+    uint64_t Size;
+}S_MappedFile;
+
+typedef struct S_Thread_t
+{
+    pthread_t Thread;
+    THREAD_PROC Proc;
+    void *UserPtr;
+}S_Thread;
+
 static const char  gUSER_HOME_DIR[] = "/home"; // not necessarily true
 static const int gUSER_HOME_DIR_LEN = sizeof(gUSER_HOME_DIR) / sizeof(gUSER_HOME_DIR[0]);
 
@@ -77,6 +96,281 @@ uint64_t rp_GetFileSize(const char *file)
         return s.st_size;
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_GetFileInfo(const char *file, S_FileInfo *info)
+{
+    struct stat s;
+    ORP_ERR r = ORP_ERR_NO_ERROR;
+
+    if(stat(file, &s) == -1)
+        r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, NULL);
+    else
+    {
+        info->Size = s.st_size;
+        info->ModifiedTime = (int64_t)s.st_mtim.tv_sec * 1000000000 + s.st_mtim.tv_nsec;
+        info->Device = s.st_dev;
+        info->Inode = s.st_ino;
+    }
+
+    return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ReplaceFile(const char *from, const char *to)
+{
+    // rename is atomic, readers see either the old or the new file
+    ORP_ERR r = ORP_ERR_NO_ERROR;
+
+    if(rename(from, to) == -1)
+        r = rp_SetLastError(ORP_ERR_FILE_IO, " rename failed: %s. ", to);
+
+    return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned long rp_GetProcessId(void)
+{
+    return (unsigned long)getpid();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint64_t rp_GetTickCount(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicIncrement(volatile long *value)
+{
+    return __atomic_add_fetch(value, 1, __ATOMIC_ACQ_REL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicDecrement(volatile long *value)
+{
+    return __atomic_sub_fetch(value, 1, __ATOMIC_ACQ_REL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicLoad(volatile long *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AtomicStore(volatile long *value, long newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *rp_AtomicLoadPointer(void *volatile *pointer)
+{
+    return __atomic_load_n(pointer, __ATOMIC_ACQUIRE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AtomicStorePointer(void *volatile *pointer, void *newValue)
+{
+    __atomic_store_n(pointer, newValue, __ATOMIC_RELEASE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SpinLock(S_SpinLock *lock)
+{
+    // only held for short critical sections, give up the time slice instead of burning it while waiting
+    while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE))
+        sched_yield();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SpinUnlock(S_SpinLock *lock)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static void *rp_ThreadMain(void *userPtr)
+{
+    S_Thread *thread = userPtr;
+    thread->Proc(thread->UserPtr);
+
+    return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_JoinThread(ORP_HANDLE hThread)
+{
+    assert(hThread != NULL);
+
+    S_Thread *thread = rp_HandleToTarget(hThread);
+    pthread_join(thread->Thread, NULL);
+    rp_free(thread);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_CreateThread(THREAD_PROC proc, void *userPtr)
+{
+    assert(proc != NULL);
+
+    ORP_HANDLE hThread = NULL;
+    S_Thread *thread = rp_malloc(sizeof(S_Thread));
+
+    if(thread)
+    {
+        thread->Proc = proc;
+        thread->UserPtr = userPtr;
+
+        if(pthread_create(&thread->Thread, NULL, rp_ThreadMain, thread) != 0)
+        {
+            rp_SetLastError(ORP_ERR_SYSTEM, " pthread_create failed. ");
+            rp_free(thread);
+        }
+        else if(!(hThread = rp_CreateHandle(thread, rp_JoinThread)))
+        {
+            // the thread is already running, it has to finish before its state can be freed
+            pthread_join(thread->Thread, NULL);
+            rp_free(thread);
+        }
+    }
+
+    return hThread;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int rp_GetProcessorCount(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_UnmapFile(ORP_HANDLE hMap)
+{
+    assert(hMap != NULL);
+
+    S_MappedFile *mf = rp_HandleToTarget(hMap);
+    if(mf->Data)
+        munmap(mf->Data, mf->Size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_MapFile(const char *file)
+{
+    assert(file != NULL);
+
+    ORP_ERR r = ORP_ERR_NO_ERROR;
+    ORP_HANDLE hMap = NULL;
+    S_MappedFile mf = { 0 };
+    struct stat s;
+
+    int fd = open(file, O_RDONLY);
+    if(fd == -1)
+        r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, NULL);
+    else
+    {
+        if(fstat(fd, &s) == -1)
+            r = rp_SetLastError(ORP_ERR_SYSTEM, " fstat failed: %s. ", file);
+        else
+        {
+            mf.Size = s.st_size;
+
+            if(mf.Size > 0) // zero length mappings aren't allowed, an empty file has no data
+            {
+                mf.Data = mmap(NULL, mf.Size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(mf.Data == MAP_FAILED)
+                {
+                    mf.Data = NULL;
+                    r = rp_SetLastError(ORP_ERR_SYSTEM, " mmap failed: %s. ", file);
+                }
+            }
+
+            if(r == ORP_ERR_NO_ERROR)
+            {
+                hMap = rp_CopyToHandle(&mf, sizeof(S_MappedFile), rp_UnmapFile);
+                if(!hMap && mf.Data)
+                    munmap(mf.Data, mf.Size);
+            }
+        }
+
+        close(fd); // mapping stays valid after the descriptor is closed
+    }
+
+    return hMap;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const void *rp_GetMappedFileData(ORP_HANDLE hMap, uint64_t *size)
+{
+    assert(hMap != NULL);
+
+    S_MappedFile *mf = rp_HandleToTarget(hMap);
+    if(size)
+        *size = mf->Size;
+
+    return mf->Data;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -9,6 +9,19 @@
 #include <Windows.h>
 #include <UserEnv.h>
 
+typedef struct S_MappedFile_t
+{
+	void *Data;
+	uint64_t Size;
+}S_MappedFile;
+
+typedef struct S_Thread_t
+{
+	HANDLE Thread;
+	THREAD_PROC Proc;
+	void *UserPtr;
+}S_Thread;
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -66,6 +79,295 @@ uint64_t rp_GetFileSize(const char *file)
 	}
 }
 
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_GetFileInfo(const char *file, S_FileInfo *info)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	BY_HANDLE_FILE_INFORMATION fi;
+
+	HANDLE hFile = CreateFileA(file, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, NULL);
+	else
+	{
+		if(GetFileInformationByHandle(hFile, &fi))
+		{
+			info->Size = ((uint64_t)fi.nFileSizeHigh << 32) | fi.nFileSizeLow;
+			info->ModifiedTime = (int64_t)(((uint64_t)fi.ftLastWriteTime.dwHighDateTime << 32) | fi.ftLastWriteTime.dwLowDateTime);
+			info->Device = fi.dwVolumeSerialNumber;
+			info->Inode = ((uint64_t)fi.nFileIndexHigh << 32) | fi.nFileIndexLow;
+		}
+		else
+			r = rp_SetLastError(ORP_ERR_SYSTEM, " GetFileInformationByHandle failed: %s. ", file);
+
+		CloseHandle(hFile);
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ReplaceFile(const char *from, const char *to)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+
+	if(!MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING))
+		r = rp_SetLastError(ORP_ERR_FILE_IO, " MoveFileEx failed: %s. ", to);
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned long rp_GetProcessId(void)
+{
+	return GetCurrentProcessId();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint64_t rp_GetTickCount(void)
+{
+	return GetTickCount64();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicIncrement(volatile long *value)
+{
+	return InterlockedIncrement(value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicDecrement(volatile long *value)
+{
+	return InterlockedDecrement(value);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+long rp_AtomicLoad(volatile long *value)
+{
+	return InterlockedCompareExchange(value, 0, 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AtomicStore(volatile long *value, long newValue)
+{
+	InterlockedExchange(value, newValue);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *rp_AtomicLoadPointer(void *volatile *pointer)
+{
+	return InterlockedCompareExchangePointer(pointer, NULL, NULL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_AtomicStorePointer(void *volatile *pointer, void *newValue)
+{
+	InterlockedExchangePointer(pointer, newValue);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SpinLock(S_SpinLock *lock)
+{
+	// only held for short critical sections, give up the time slice instead of burning it while waiting
+	while(InterlockedExchange(lock, 1))
+		SwitchToThread();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SpinUnlock(S_SpinLock *lock)
+{
+	InterlockedExchange(lock, 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static DWORD WINAPI rp_ThreadMain(LPVOID userPtr)
+{
+	S_Thread *thread = userPtr;
+	thread->Proc(thread->UserPtr);
+
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_JoinThread(ORP_HANDLE hThread)
+{
+	assert(hThread != NULL);
+
+	S_Thread *thread = rp_HandleToTarget(hThread);
+	WaitForSingleObject(thread->Thread, INFINITE);
+	CloseHandle(thread->Thread);
+	rp_free(thread);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_CreateThread(THREAD_PROC proc, void *userPtr)
+{
+	assert(proc != NULL);
+
+	ORP_HANDLE hThread = NULL;
+	S_Thread *thread = rp_malloc(sizeof(S_Thread));
+
+	if(thread)
+	{
+		thread->Proc = proc;
+		thread->UserPtr = userPtr;
+		thread->Thread = CreateThread(NULL, 0, rp_ThreadMain, thread, 0, NULL);
+
+		if(!thread->Thread)
+		{
+			rp_SetLastError(ORP_ERR_SYSTEM, " CreateThread failed. ");
+			rp_free(thread);
+		}
+		else if(!(hThread = rp_CreateHandle(thread, rp_JoinThread)))
+		{
+			// the thread is already running, it has to finish before its state can be freed
+			WaitForSingleObject(thread->Thread, INFINITE);
+			CloseHandle(thread->Thread);
+			rp_free(thread);
+		}
+	}
+
+	return hThread;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int rp_GetProcessorCount(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_UnmapFile(ORP_HANDLE hMap)
+{
+	assert(hMap != NULL);
+
+	S_MappedFile *mf = rp_HandleToTarget(hMap);
+	if(mf->Data)
+		UnmapViewOfFile(mf->Data);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_MapFile(const char *file)
+{
+	assert(file != NULL);
+
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	ORP_HANDLE hMap = NULL;
+	S_MappedFile mf = { 0 };
+	LARGE_INTEGER size;
+
+	HANDLE hFile = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, NULL);
+	else
+	{
+		if(!GetFileSizeEx(hFile, &size))
+			r = rp_SetLastError(ORP_ERR_SYSTEM, " GetFileSizeEx failed: %s. ", file);
+		else
+		{
+			mf.Size = (uint64_t)size.QuadPart;
+
+			if(mf.Size > 0) // CreateFileMapping fails on empty files, an empty file has no data
+			{
+				HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+				if(hMapping)
+				{
+					mf.Data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+					if(!mf.Data)
+						r = rp_SetLastError(ORP_ERR_SYSTEM, " MapViewOfFile failed: %s. ", file);
+
+					CloseHandle(hMapping); // the view keeps the mapping alive
+				}
+				else
+					r = rp_SetLastError(ORP_ERR_SYSTEM, " CreateFileMapping failed: %s. ", file);
+			}
+
+			if(r == ORP_ERR_NO_ERROR)
+			{
+				hMap = rp_CopyToHandle(&mf, sizeof(S_MappedFile), rp_UnmapFile);
+				if(!hMap && mf.Data)
+					UnmapViewOfFile(mf.Data);
+			}
+		}
+
+		CloseHandle(hFile);
+	}
+
+	return hMap;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const void *rp_GetMappedFileData(ORP_HANDLE hMap, uint64_t *size)
+{
+	assert(hMap != NULL);
+
+	S_MappedFile *mf = rp_HandleToTarget(hMap);
+	if(size)
+		*size = mf->Size;
+
+	return mf->Data;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -0,0 +1,159 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/util/Arena.h"
+#include "OpenRP1210/Common.h"
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define ARENA_ALIGNMENT 8
+#define ARENA_MIN_BLOCK_SIZE 4096
+#define ARENA_MAX_BLOCK_SIZE (1024 * 1024)
+
+#define ARENA_ALIGN(x) (((x) + (ARENA_ALIGNMENT - 1)) & ~((size_t)ARENA_ALIGNMENT - 1))
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ArenaBlock_t
+{
+	struct S_ArenaBlock_t *NextBlock;
+	size_t Size;
+	size_t Used;
+}S_ArenaBlock;
+
+#define ARENA_HEADER_SIZE ARENA_ALIGN(sizeof(S_ArenaBlock))
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ArenaInit(S_Arena *arena, size_t initialBlockSize)
+{
+	arena->Blocks = NULL;
+	arena->NextBlockSize = initialBlockSize < ARENA_MIN_BLOCK_SIZE ? ARENA_MIN_BLOCK_SIZE : initialBlockSize;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ArenaFree(S_Arena *arena)
+{
+	S_ArenaBlock *block = arena->Blocks;
+
+	while(block)
+	{
+		S_ArenaBlock *next = block->NextBlock;
+		rp_free(block);
+		block = next;
+	}
+
+	arena->Blocks = NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ArenaAdopt(S_Arena *arena, S_Arena *other)
+{
+	S_ArenaBlock *first = other->Blocks;
+
+	if(first)
+	{
+		S_ArenaBlock *last = first;
+		while(last->NextBlock)
+			last = last->NextBlock;
+
+		// link behind the current block, new allocations keep using its free space
+		if(arena->Blocks)
+		{
+			last->NextBlock = arena->Blocks->NextBlock;
+			arena->Blocks->NextBlock = first;
+		}
+		else
+			arena->Blocks = first;
+
+		other->Blocks = NULL;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_ArenaBlock *rp_ArenaAddBlock(S_Arena *arena, size_t size)
+{
+	// oversized requests get a block of their own, linked behind the current block
+	// so the remaining space in the current block can still be used
+	bool dedicated = size > arena->NextBlockSize / 4;
+	size_t blockSize = dedicated ? size : arena->NextBlockSize;
+
+	S_ArenaBlock *block = rp_malloc(ARENA_HEADER_SIZE + blockSize);
+	if(block)
+	{
+		block->Size = blockSize;
+		block->Used = 0;
+
+		if(dedicated && arena->Blocks)
+		{
+			block->NextBlock = arena->Blocks->NextBlock;
+			arena->Blocks->NextBlock = block;
+		}
+		else
+		{
+			block->NextBlock = arena->Blocks;
+			arena->Blocks = block;
+
+			// grow geometrically so the number of blocks stays logarithmic in the total size
+			if(arena->NextBlockSize < ARENA_MAX_BLOCK_SIZE)
+				arena->NextBlockSize *= 2;
+		}
+	}
+
+	return block;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *rp_ArenaAlloc(S_Arena *arena, size_t size)
+{
+	void *p = NULL;
+	size = ARENA_ALIGN(size > 0 ? size : 1);
+
+	S_ArenaBlock *block = arena->Blocks;
+	if(!block || block->Size - block->Used < size)
+		block = rp_ArenaAddBlock(arena, size);
+
+	if(block)
+	{
+		assert(block->Size - block->Used >= size);
+
+		p = (unsigned char *)block + ARENA_HEADER_SIZE + block->Used;
+		block->Used += size;
+	}
+
+	return p;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *rp_ArenaAllocZ(S_Arena *arena, size_t size)
+{
+	void *p = rp_ArenaAlloc(arena, size);
+
+	if(p)
+		memset(p, 0, size);
+
+	return p;
+}
@@ -0,0 +1,112 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/util/Hash.h"
+
+#include <string.h>
+
+#define HASH_MULTIPLIER 0x9E3779B97F4A7C15ull
+#define BYTES(b) (0x0101010101010101ull * (b))
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static inline uint64_t rp_FoldWord(uint64_t word)
+{
+	// ASCII lower case of 8 bytes at once: bytes in 'A'..'Z' get their high bit set
+	// in upper, which shifted down is the 0x20 that makes them lower case
+	uint64_t low = word & BYTES(0x7F);
+	uint64_t atLeastA = low + BYTES(0x80 - 'A');
+	uint64_t aboveZ = low + BYTES(0x80 - 'Z' - 1);
+	uint64_t upper = atLeastA & ~aboveZ & ~word & BYTES(0x80);
+
+	return word | (upper >> 2);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static inline uint64_t rp_HashWord(uint64_t hash, uint64_t word)
+{
+	hash = (hash ^ word) * HASH_MULTIPLIER;
+	return hash ^ (hash >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static inline uint32_t rp_Hash(const char *str, size_t length, bool foldCase, char *folded)
+{
+	// 8 bytes per step, the folded copy is written in the same pass
+	uint64_t hash = length;
+	uint64_t word;
+	size_t i = 0;
+
+	for(; i + sizeof(word) <= length; i += sizeof(word))
+	{
+		memcpy(&word, str + i, sizeof(word));
+
+		if(foldCase)
+			word = rp_FoldWord(word);
+		if(folded)
+			memcpy(folded + i, &word, sizeof(word));
+
+		hash = rp_HashWord(hash, word);
+	}
+
+	if(i < length)
+	{
+		word = 0;
+		memcpy(&word, str + i, length - i);
+
+		if(foldCase)
+			word = rp_FoldWord(word);
+		if(folded)
+			memcpy(folded + i, &word, length - i);
+
+		hash = rp_HashWord(hash, word);
+	}
+
+	hash = (hash ^ (hash >> 29)) * HASH_MULTIPLIER;
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_HashString(const char *str, size_t length, bool foldCase)
+{
+	// optionally over the ASCII lower case form so that strings which
+	// compare equal with strncasecmp also hash equal
+	return rp_Hash(str, length, foldCase, NULL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_HashFoldString(const char *str, size_t length, char *folded)
+{
+	return rp_Hash(str, length, true, folded);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_HashTableSize(size_t count)
+{
+	// power of 2 slot count that keeps an open addressed table at most half full
+	uint32_t size = 8;
+
+	while(size < count * 2 && size < 0x80000000u)
+		size <<= 1;
+
+	return size;
+}
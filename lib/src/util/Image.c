@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/util/Image.h"
+#include "OpenRP1210/platform/Platform.h"
+#include "OpenRP1210/Common.h"
+#include <stdio.h>
+#include <string.h>
+
+static volatile long gImageSaves; // numbers the temporary files of rp_SaveImage
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_ImageBodyChecksum(const unsigned char *image, uint32_t headerSize, uint32_t imageSize)
+{
+	// Fletcher style sums over 32 bit words
+	const uint32_t *words = (const uint32_t *)(image + headerSize);
+	size_t numWords = (imageSize - headerSize) / sizeof(uint32_t);
+	uint64_t a = 0, b = 0;
+
+	for(size_t i = 0; i < numWords; i++)
+	{
+		a += words[i];
+		b += a;
+	}
+
+	return (uint32_t)(a ^ (a >> 32) ^ b ^ (b >> 29));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ImageRange(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t imageSize)
+{
+	return offset % sizeof(uint32_t) == 0 && offset <= imageSize && count <= (imageSize - offset) / elementSize;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_SaveImage(const char *path, const unsigned char *image, uint32_t imageSize)
+{
+	size_t len = strlen(path) + 48;
+	char *tempPath = rp_malloc(len);
+	bool saved = false;
+
+	if(tempPath)
+	{
+		rp_Concat(tempPath, len, "%s.%lu.%ld.tmp", path, rp_GetProcessId(), rp_AtomicIncrement(&gImageSaves));
+
+		FILE *fp = fopen(tempPath, "wb");
+		if(fp)
+		{
+			bool written = fwrite(image, 1, imageSize, fp) == imageSize;
+
+			saved = fclose(fp) == 0 && written && rp_ReplaceFile(tempPath, path) == ORP_ERR_NO_ERROR;
+
+			if(!saved)
+				remove(tempPath);
+		}
+
+		rp_free(tempPath);
+	}
+
+	return saved;
+}
@@ -4,6 +4,11 @@
 //  file, You can obtain one at http://mozilla.org/MPL/2.0/.
 //------------------------------------------------------------------------------
 #include "OpenRP1210/util/Ini.h"
+#include "OpenRP1210/util/Arena.h"
+#include "OpenRP1210/util/Hash.h"
+#include "OpenRP1210/util/Image.h"
+#include "OpenRP1210/util/Scan.h"
+#include "OpenRP1210/util/Parallel.h"
 #include "OpenRP1210/Common.h"
 #include "OpenRP1210/platform/Platform.h"
 #include <stdio.h>
@@ -13,17 +18,34 @@
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
+#include <stddef.h>
 
 #if defined _WIN32 || defined _WIN64
-	#define STRICMP _stricmp
+	#define STRNICMP _strnicmp
 #else
 	#include <strings.h>
-	#define STRICMP strcasecmp
+	#define STRNICMP strncasecmp
 #endif
 
 #define CARRIGE_RETURN 0x0D
 #define LINE_FEED 0x0A
 
+#define NAME_BUFFER_SIZE 128
+
+#define SNAPSHOT_EXT ".snap"
+#define SNAPSHOT_MAGIC 0x49505230u // "0RPI" in little endian byte order
+#define SNAPSHOT_VERSION 2
+
+// files at least this big are split at section boundaries and tokenized on several threads
+#define PARALLEL_PARSE_MIN_SIZE (1024 * 1024)
+#define PARALLEL_PARSE_MIN_CHUNK (256 * 1024)
+#define PARALLEL_PARSE_MAX_CHUNKS 16
+
+#define TYPED_INT 0x1
+#define TYPED_BOOL 0x2
+#define TYPED_INT_LIST 0x4
+#define TYPED_STRING_LIST 0x8
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -48,6 +70,66 @@ typedef enum E_IniSymbolType_t
 	SYM_SectionName,
 }E_IniSymbolType;
 
+/////////////////////////////////////////////////////////////////////////////////
+/// Open addressed hash table of section or key name symbols.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniIndex_t
+{
+	struct S_IniSymbol_t **Slots;
+	uint32_t Mask; // slot count - 1, the slot count is a power of 2
+}S_IniIndex;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_PooledName_t
+{
+	const char *Name; // NULL for an empty slot
+	size_t Length;
+	uint32_t Hash;
+}S_PooledName;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Distinct case folded key names of an INI, see rp_InternName. Grows as names are
+/// added, INIs usually repeat the same few key names in every section.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_NamePool_t
+{
+	S_PooledName *Slots;
+	uint32_t Mask;
+	uint32_t Count;
+}S_NamePool;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Unparsed keys of a section of an INI opened with S_IniConfig::LazySections.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_LazySection_t
+{
+	int64_t Start;          // just past the section header
+	int64_t End;            // start of the next section header or the end of the data
+	unsigned int Line;      // line of the section header
+	ORP_ERR Error;          // parse error of an earlier attempt, reported again on every lookup
+	unsigned int ErrorLine;
+}S_LazySection;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Parsed forms of a key value, created by the typed accessors the first time a
+/// form is read and kept until the INI is freed.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniTypedValue_t
+{
+	volatile long Parsed; // TYPED_* flags of the forms below that are set, published after the form
+	int Int;
+	bool Bool;
+	int *Ints;
+	size_t NumInts;
+	const char **Strings;
+	size_t NumStrings;
+}S_IniTypedValue;
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
@@ -55,32 +137,163 @@ typedef enum E_IniSymbolType_t
 typedef struct S_IniSymbol_t
 {
 	E_IniSymbolType Type;
+	uint32_t Hash;     // hash of Value, case folded when keys are case insensitive
+	bool Shadowed;     // duplicate name that lookups never resolve to, per S_IniConfig::DuplicateMode
 	struct S_IniSymbol_t *NextSymbol;
 	struct S_IniSymbol_t *PrevSymbol;
 	struct S_IniSymbol_t *Children;
-	char *Value;
+	struct S_IniSymbol_t *LastChild;
+	const char *Value; // view into the INI data, not NUL-terminated
+	size_t Length;
+	const char *Name;  // Value as lookups compare it, an interned case folded copy when keys are case insensitive
+	char *String;      // NUL-terminated copy of Value, created on demand
+	S_IniIndex *KeyIndex; // key lookup table of a section
+	S_LazySection *Lazy;  // set until the keys of a lazily parsed section are parsed
+	S_IniTypedValue *volatile Typed; // parsed forms of a key value, see rp_GetTypedValue
 }S_IniSymbol;
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-typedef struct S_EnumKey_t
+typedef struct S_Ini_t
+{
+	S_IniConfig Config;
+	S_IniSymbol *FirstSection;
+	S_IniSymbol *LastSection;
+	S_IniIndex SectionIndex;
+
+	S_Arena Arena;       // all symbols and strings of the INI are allocated here
+	unsigned char *Data; // INI file contents, owned by S_Ini when the file was read into memory
+	ORP_HANDLE hMap;     // memory mapped INI file when S_IniConfig::MemoryMapped is set, or the mapped snapshot
+
+	const struct S_SnapshotHeader_t *Snapshot; // set instead of the symbol tree when loaded from a snapshot
+
+	const unsigned char *Source; // INI data lazy sections are parsed from, either Data or the mapping
+	S_NamePool Names;            // interned key names, kept while sections are still to be parsed
+
+	S_IniTypedValue *volatile *volatile SnapshotTyped; // parsed forms of snapshot keys by key index, allocated on the first typed read
+
+	bool Shared;               // registered in gSharedInis, see rp_ShareIni
+	long RefCount;             // handles to a shared INI, guarded by gSharedLock
+	S_FileInfo SharedInfo;     // the file a shared INI was read from
+	struct S_Ini_t *NextShared;
+	S_SpinLock Lock;           // serializes typed value parsing of a shared INI
+}S_Ini;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Binary snapshot of a parsed INI, see rp_SaveSnapshot.
+/// All offsets are from the start of the image, strings are NUL-terminated.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_SnapshotHeader_t
+{
+	uint32_t Magic;
+	uint16_t Version;
+	uint16_t HeaderSize;
+	uint32_t ImageSize;
+	uint32_t Config;        // rp_SnapshotConfig of the config the INI was parsed with
+
+	uint64_t SourceSize;    // S_FileInfo of the INI the snapshot was created from
+	int64_t SourceTime;
+	uint64_t SourceDevice;
+	uint64_t SourceInode;
+
+	uint32_t SectionSlots;  // uint32_t[SectionMask + 1], section index + 1 or 0 for an empty slot
+	uint32_t SectionMask;
+	uint32_t Sections;      // S_SnapshotSection[NumSections]
+	uint32_t NumSections;
+	uint32_t Keys;          // S_SnapshotKey[NumKeys]
+	uint32_t NumKeys;
+	uint32_t KeySlots;      // uint32_t[NumKeySlots], key index within the section + 1 or 0 for an empty slot
+	uint32_t NumKeySlots;
+	uint32_t Strings;
+	uint32_t StringsSize;
+
+	uint32_t BodyChecksum;  // of everything after the header
+	uint32_t Checksum;      // of the header fields above
+}S_SnapshotHeader;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Only sections and keys that lookups resolve to are stored, keys in enumeration order.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_SnapshotSection_t
 {
-	S_IniSymbol *Key;
-	struct S_EnumKey_t *NextKey;
-}S_EnumKey;
+	uint32_t Name;
+	uint32_t NameLength;
+	uint32_t LookupName;    // Name as lookups compare it, see S_IniSymbol::Name
+	uint32_t Hash;
+	uint32_t FirstKey;
+	uint32_t NumKeys;
+	uint32_t FirstSlot;
+	uint32_t SlotMask;
+}S_SnapshotSection;
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-typedef struct S_Ini_t
+typedef struct S_SnapshotKey_t
 {
-	S_IniConfig Config;
-	S_IniSymbol *FirstSection;
-	S_IniSymbol *LastSection;
-}S_Ini;
+	uint32_t Name;
+	uint32_t NameLength;
+	uint32_t LookupName;
+	uint32_t Hash;
+	uint32_t Value;
+	uint32_t ValueLength;
+}S_SnapshotKey;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// A section or key name to look up, prepared once so that it compares with memcmp.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniName_t
+{
+	const char *Name;   // case folded when keys are case insensitive, NULL if the name didn't fit Buffer
+	const char *Source; // the name as passed by the caller
+	size_t Length;
+	uint32_t Hash;
+	char Buffer[NAME_BUFFER_SIZE];
+}S_IniName;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// A section found by rp_FindSection, either in the symbol tree or in a snapshot.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniSection_t
+{
+	S_IniSymbol *Symbol;
+	const S_SnapshotSection *Entry;
+}S_IniSection;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// A key value found by rp_FindKey.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniValue_t
+{
+	const char *Value;
+	size_t Length;
+	S_IniSymbol *Symbol; // NULL for snapshot values, which are already NUL-terminated
+	uint32_t Key;        // index of a snapshot key
+}S_IniValue;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+struct S_ParseContext_t;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Receives the tokens of an INI in file order. A handler returns false to stop
+/// parsing, either because it's done or because it set an error.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ParseHandler_t
+{
+	bool (*Section)(struct S_ParseContext_t *context, S_Offset *name);
+	bool (*Key)(struct S_ParseContext_t *context, S_Offset *key, S_Offset *value); // value is NULL for a blank key i.e. KEY=, Key is NULL to skip key lines
+	void *UserPtr;
+}S_ParseHandler;
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
@@ -88,7 +301,7 @@ typedef struct S_Ini_t
 /////////////////////////////////////////////////////////////////////////////////
 typedef struct S_ParseContext_t
 {
-	unsigned char *Data;
+	const unsigned char *Data;
 	int64_t DataLength;
 
 	int64_t CurrentOffset;
@@ -96,15 +309,119 @@ typedef struct S_ParseContext_t
 
 	unsigned int SymbolCount;
 	S_IniConfig Config;
+	S_Arena Arena;
+
+	S_ParseHandler Handler;
+	bool InSection; // keys are only legal after the first section
+	bool Stop;
 }S_ParseContext;
 
+/////////////////////////////////////////////////////////////////////////////////
+/// Symbol tree under construction, the S_ParseHandler::UserPtr of rp_ParseIni.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_TreeBuilder_t
+{
+	S_IniSymbol *FirstSection;
+	S_IniSymbol *LastSection;
+}S_TreeBuilder;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// One part of a file tokenized on its own by rp_ParseChunks. Line numbers
+/// count from the start of the chunk.
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ParseChunk_t
+{
+	S_ParseContext Context;
+	S_TreeBuilder Tree;
+	ORP_ERR Error;
+}S_ParseChunk;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// User callbacks of rp_IniParseStream, the S_ParseHandler::UserPtr of the stream parser.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_StreamCallbacks_t
+{
+	STREAM_SECTION_CALLBACK Section;
+	STREAM_KEY_CALLBACK Key;
+	void *UserPtr;
+}S_StreamCallbacks;
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Loaded INI file contents, either read into a buffer or memory mapped.
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_IniSource_t
+{
+	const unsigned char *Data;
+	int64_t DataLength;
+	unsigned char *Buffer;
+	ORP_HANDLE hMap;
+}S_IniSource;
+
+static S_SpinLock gSharedLock;
+static S_Ini *gSharedInis; // guarded by gSharedLock
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_InitializeName(S_IniName *name, const char *s, size_t length, S_IniConfig *config)
+{
+	name->Source = s;
+	name->Length = length;
+
+	if(!config->KeysCaseInsensitive)
+	{
+		name->Hash = rp_HashString(s, name->Length, false);
+		name->Name = s;
+	}
+	else if(name->Length <= NAME_BUFFER_SIZE)
+	{
+		name->Hash = rp_HashFoldString(s, name->Length, name->Buffer);
+		name->Name = name->Buffer;
+	}
+	else
+	{
+		name->Hash = rp_HashString(s, name->Length, true);
+		name->Name = NULL;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_NameEquals(const char *lookupName, size_t length, uint32_t hash, S_IniName *name)
+{
+	// lookupName is already case folded when keys are case insensitive, only overly long names are folded here
+	if(hash != name->Hash || length != name->Length)
+		return false;
+	else if(name->Name)
+		return memcmp(lookupName, name->Name, length) == 0;
+	else
+		return STRNICMP(lookupName, name->Source, length) == 0;
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-int rp_StrCmp(const char *s1, const char *s2, bool caseSensitive)
+const char *rp_SymbolString(S_Ini *ini, S_IniSymbol *symbol)
 {
-	return caseSensitive ? strcmp(s1, s2) : STRICMP(s1, s2);
+	// materialize a NUL-terminated copy of the symbol the first time one is needed
+	if(!symbol->String)
+	{
+		symbol->String = rp_ArenaAlloc(&ini->Arena, symbol->Length + 1);
+		if(symbol->String)
+		{
+			memcpy(symbol->String, symbol->Value, symbol->Length);
+			symbol->String[symbol->Length] = 0;
+		}
+	}
+
+	return symbol->String;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -180,7 +497,7 @@ void rp_InitializeConfig(S_IniConfig *configIn, S_IniConfig *configOut)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_Ini *rp_CreateIni(S_IniConfig *config, S_IniSymbol *firstSection, S_IniSymbol *lastSection, ORP_ERR error, const char *errorText)
+S_Ini *rp_CreateIni(S_IniConfig *config, S_Arena *arena, S_IniSymbol *firstSection, S_IniSymbol *lastSection, ORP_ERR error, const char *errorText)
 {
 	S_Ini *ini = NULL;
 
@@ -192,12 +509,20 @@ S_Ini *rp_CreateIni(S_IniConfig *config, S_IniSymbol *firstSection, S_IniSymbol
 			ini->FirstSection = firstSection;
 			ini->LastSection = lastSection;
 
+			if(arena)
+				ini->Arena = *arena; // S_Ini takes ownership of the symbol tree
+			else
+				rp_ArenaInit(&ini->Arena, 0);
+
 			rp_InitializeConfig(config, &ini->Config);
 		}
 	}
 	else if(errorText)
 		rp_SetLastError(error, errorText);
 
+	if(!ini && arena)
+		rp_ArenaFree(arena);
+
 	return ini;
 }
 
@@ -205,11 +530,16 @@ S_Ini *rp_CreateIni(S_IniConfig *config, S_IniSymbol *firstSection, S_IniSymbol
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_InitializeContext(S_ParseContext *context, S_IniConfig *config, unsigned char *data, int64_t dataLength)
+void rp_InitializeContext(S_ParseContext *context, S_IniConfig *config, const unsigned char *data, int64_t start, int64_t dataLength)
 {
+	// parsing begins at start and ends at dataLength, offsets stay relative to data
 	memset(context, 0, sizeof(S_ParseContext));
 	context->Data = data;
 	context->DataLength = dataLength;
+	context->CurrentOffset = start;
+
+	// RP1210 INIs average one symbol per 12-16 bytes of data, size the first block so most files need only one
+	rp_ArenaInit(&context->Arena, (size_t)((dataLength - start) / 12) * sizeof(S_IniSymbol));
 
 	rp_InitializeConfig(config, &context->Config);
 }
@@ -227,23 +557,14 @@ bool rp_IsPrintable(char c)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-int64_t rp_FindChar(S_ParseContext *context, char c, int64_t startOffset, int64_t endOffset, bool breakOnNonPrintable)
+int64_t rp_FindChar(S_ParseContext *context, char c, int64_t startOffset, int64_t endOffset)
 {
+	// searching always stops at a non-printable character, c must be on the same line
 	if(endOffset < 0)
 		endOffset = context->DataLength;
 
-	while(startOffset < endOffset)
-	{
-		if(breakOnNonPrintable && !rp_IsPrintable(context->Data[startOffset]))
-			break;
-		else
-		{
-			if(context->Data[startOffset] != c && rp_IsPrintable(context->Data[startOffset]))
-				startOffset++;
-			else
-				break;
-		}
-	}
+	if(startOffset < endOffset)
+		startOffset += rp_ScanToCharOrControl(context->Data + startOffset, (size_t)(endOffset - startOffset), (unsigned char)c);
 
 	return startOffset >= context->DataLength ? -1 : (context->Data[startOffset] == c ? startOffset : -1);
 }
@@ -311,12 +632,10 @@ bool rp_FindNewLine(S_ParseContext *context, int64_t startOffset, S_Offset *newL
 	bool found = false;
 	unsigned char lineCharCount = 0;
 
-	while(!found && startOffset < context->DataLength)
+	if(startOffset < context->DataLength)
 	{
-		if(rp_IsNewLine(context, startOffset, &lineCharCount))
-			found = true;
-		else
-			startOffset++;
+		startOffset += rp_ScanToNewLine(context->Data + startOffset, (size_t)(context->DataLength - startOffset));
+		found = rp_IsNewLine(context, startOffset, &lineCharCount);
 	}
 
 	if(found && newLineOffset)
@@ -347,22 +666,21 @@ void rp_NextLine(S_ParseContext *context)
 /////////////////////////////////////////////////////////////////////////////////
 void rp_SkipWhiteSpace(S_ParseContext *context)
 {
-	unsigned char lineCharCount = 0;
-
-	while(context->CurrentOffset < context->DataLength)
+	if(context->CurrentOffset < context->DataLength)
 	{
-		if(rp_IsNewLine(context, context->CurrentOffset, &lineCharCount))
-		{
-			context->CurrentOffset += lineCharCount;
-			context->CurrentLine++;
-		}
-		else
+		int64_t offset = context->CurrentOffset;
+		int64_t endOffset = offset + rp_ScanToNonSpace(context->Data + offset, (size_t)(context->DataLength - offset));
+
+		// CR LF, LF and a lone CR each end one line, runs of blank lines are short so count them bytewise
+		for(; offset < endOffset; offset++)
 		{
-			if(!rp_IsPrintable(rp_PeekChar(context)) || rp_PeekChar(context) == ' ')
-				context->CurrentOffset++;
-			else
-				break;
+			if(context->Data[offset] == LINE_FEED)
+				context->CurrentLine++;
+			else if(context->Data[offset] == CARRIGE_RETURN && (offset + 1 >= context->DataLength || context->Data[offset + 1] != LINE_FEED))
+				context->CurrentLine++;
 		}
+
+		context->CurrentOffset = endOffset;
 	}
 }
 
@@ -370,44 +688,28 @@ void rp_SkipWhiteSpace(S_ParseContext *context)
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_LastSymbol(S_IniSymbol *symbol)
+size_t rp_ViewLength(const char *value, size_t length)
 {
-	S_IniSymbol *s = symbol;
-
-	while(s->NextSymbol)
-		s = s->NextSymbol;
-
-	return s;
+	// values end at an embedded NUL, same as a C string copy of the data would
+	const char *nul = length > 0 ? memchr(value, 0, length) : NULL;
+	return nul ? (size_t)(nul - value) : length;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_CreateSymbol(E_IniSymbolType symbolType, char *iniData, int64_t startOffset, int64_t endOffset)
+S_IniSymbol *rp_CreateSymbol(S_Arena *arena, E_IniSymbolType symbolType, const char *iniData, int64_t startOffset, int64_t endOffset)
 {
-	S_IniSymbol *symbol = rp_malloc(sizeof(S_IniSymbol));
+	S_IniSymbol *symbol = rp_ArenaAllocZ(arena, sizeof(S_IniSymbol));
 	if(symbol)
 	{
 		assert(endOffset - startOffset + 1 <= SIZE_MAX);
 		size_t len = iniData == NULL ? 0 : (size_t)(endOffset - startOffset + 1);
 
-		memset(symbol, 0, sizeof(S_IniSymbol));
 		symbol->Type = symbolType;
-		symbol->Value = rp_malloc(len + 1);
-
-		if(symbol->Value)
-		{
-			if(iniData)
-				strncpy(symbol->Value, iniData + startOffset, len);
-
-			symbol->Value[len] = 0;
-		}
-		else
-		{
-			rp_free(symbol);  // couldn't fully construct the symbol
-			symbol = NULL;
-		}
+		symbol->Value = iniData ? iniData + startOffset : "";
+		symbol->Length = rp_ViewLength(symbol->Value, len);
 	}
 
 	return symbol;
@@ -417,43 +719,29 @@ S_IniSymbol *rp_CreateSymbol(E_IniSymbolType symbolType, char *iniData, int64_t
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_DestroySymbol(S_IniSymbol *symbol)
-{
-	if(symbol->Children)
-		rp_DestroySymbol(symbol->Children);
-
-	if(symbol->NextSymbol)
-		rp_DestroySymbol(symbol->NextSymbol);
-
-	rp_free(symbol->Value);
-	rp_free(symbol);
-}
-
-/////////////////////////////////////////////////////////////////////////////////
-///
-///
-/////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_CreateEmptySymbol(E_IniSymbolType symbolType)
+S_IniSymbol *rp_CreateEmptySymbol(S_Arena *arena, E_IniSymbolType symbolType)
 {
-	return rp_CreateSymbol(symbolType, NULL, 0, 0);
+	return rp_CreateSymbol(arena, symbolType, NULL, 0, 0);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_AddSymbol(S_ParseContext *context, S_IniSymbol **currentSymbol, S_IniSymbol *symbol)
+S_IniSymbol *rp_AddSymbol(S_ParseContext *context, S_IniSymbol **firstSymbol, S_IniSymbol **lastSymbol, S_IniSymbol *symbol)
 {
+	// append using the tail pointer, walking the sibling list makes parsing quadratic
 	if(symbol)
 	{
-		if(*currentSymbol != NULL)
+		if(*lastSymbol != NULL)
 		{
-			S_IniSymbol *lastSym = rp_LastSymbol(*currentSymbol);
-			lastSym->NextSymbol = symbol;
-			symbol->PrevSymbol = lastSym;
+			(*lastSymbol)->NextSymbol = symbol;
+			symbol->PrevSymbol = *lastSymbol;
 		}
 		else
-			*currentSymbol = symbol;
+			*firstSymbol = symbol;
+
+		*lastSymbol = symbol;
 
 		context->SymbolCount++;
 	}
@@ -465,214 +753,1641 @@ S_IniSymbol *rp_AddSymbol(S_ParseContext *context, S_IniSymbol **currentSymbol,
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_CreateAddSymbol(S_ParseContext *context, S_IniSymbol **currentSymbol, E_IniSymbolType symbolType, int64_t startOffset, int64_t endOffset)
+S_IniSymbol *rp_CreateAddSymbol(S_ParseContext *context, S_IniSymbol **firstSymbol, S_IniSymbol **lastSymbol, E_IniSymbolType symbolType, int64_t startOffset, int64_t endOffset)
+{
+	S_IniSymbol *symbol = rp_CreateSymbol(&context->Arena, symbolType, (const char *)context->Data, startOffset, endOffset);
+	return rp_AddSymbol(context, firstSymbol, lastSymbol, symbol);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_CreateIndex(S_Arena *arena, S_IniIndex *index, size_t count)
 {
-	S_IniSymbol *symbol = rp_CreateSymbol(symbolType, (char *)context->Data, startOffset, endOffset);
-	return rp_AddSymbol(context, currentSymbol, symbol);
+	uint32_t numSlots = rp_HashTableSize(count);
+
+	index->Slots = rp_ArenaAllocZ(arena, numSlots * sizeof(S_IniSymbol *));
+	index->Mask = numSlots - 1;
+
+	return index->Slots != NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-bool rp_ContainsKey(S_EnumKey *enumKey, const char *key, bool caseSensitive)
+bool rp_GrowNamePool(S_NamePool *names)
 {
-	S_EnumKey *e = enumKey;
-	
-	if(e->Key)
+	uint32_t mask = names->Slots ? names->Mask * 2 + 1 : 63;
+	S_PooledName *slots = rp_mallocZ(((size_t)mask + 1) * sizeof(S_PooledName));
+
+	if(slots)
 	{
-		while(e)
+		for(uint32_t i = 0; names->Slots && i <= names->Mask; i++)
 		{
-			if(rp_StrCmp(e->Key->Value, key, caseSensitive) == 0)
-				break;
-			else
-				e = e->NextKey;
+			if(names->Slots[i].Name)
+			{
+				uint32_t j = names->Slots[i].Hash & mask;
+
+				while(slots[j].Name)
+					j = (j + 1) & mask;
+
+				slots[j] = names->Slots[i];
+			}
 		}
 
-		return e ? true : false;
+		rp_free(names->Slots);
+		names->Slots = slots;
+		names->Mask = mask;
 	}
-	else
-		return false;
+
+	return slots != NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-ORP_ERR rp_FindSection(S_Ini *ini, const char *section, S_IniSymbol **symbolOut)
+char *rp_CopyFoldedName(S_Ini *ini, S_IniSymbol *symbol, S_IniName *name)
 {
-	ORP_ERR r = ORP_ERR_NO_ERROR;
-	S_IniSymbol *sectionSym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? ini->FirstSection : ini->LastSection;
+	char *folded = rp_ArenaAlloc(&ini->Arena, symbol->Length + 1);
 
-	while(sectionSym)
+	if(folded)
 	{
-		if(rp_StrCmp(sectionSym->Value, section, !ini->Config.KeysCaseInsensitive) == 0)
-			break;
+		if(name->Name)
+			memcpy(folded, name->Name, symbol->Length);
 		else
-			sectionSym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? sectionSym->NextSymbol : sectionSym->PrevSymbol;
-	}
+			rp_HashFoldString(symbol->Value, symbol->Length, folded);
 
-	if(sectionSym && sectionSym->Type == SYM_SectionName)
-		*symbolOut = sectionSym;
-	else
-		r = rp_SetLastError(ORP_ERR_INI_SECTION_NOT_FOUND, " Section name = %s.", section);
+		folded[symbol->Length] = 0;
+	}
 
-	return r;
+	return folded;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-ORP_ERR rp_FindKey(S_Ini *ini, const char *section, const char *key, S_IniSymbol **symbolOut)
+bool rp_InternName(S_Ini *ini, S_NamePool *names, S_IniSymbol *symbol, S_IniName *name)
 {
-	S_IniSymbol *sectionSym;
-	ORP_ERR r = rp_FindSection(ini, section, &sectionSym);
+	// symbols with equal folded names share one copy of it
+	if(names->Count * 2 >= names->Mask && !rp_GrowNamePool(names))
+		return false;
 
-	if(r == ORP_ERR_NO_ERROR)
+	uint32_t i = name->Hash & names->Mask;
+
+	while(names->Slots[i].Name && !symbol->Name)
 	{
-		S_IniSymbol *keySym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? sectionSym->Children : rp_LastSymbol(sectionSym->Children);
+		S_PooledName *pooled = &names->Slots[i];
 
-		while(keySym)
-		{
-			if(rp_StrCmp(keySym->Value, key, !ini->Config.KeysCaseInsensitive) == 0)
-				break;
-			else
-				keySym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? keySym->NextSymbol : keySym->PrevSymbol;
-		}
+		if(rp_NameEquals(pooled->Name, pooled->Length, pooled->Hash, name))
+			symbol->Name = pooled->Name;
+		else
+			i = (i + 1) & names->Mask;
+	}
 
-		if(keySym && keySym->Type == SYM_KeyName)
-		{
-			S_IniSymbol *valueSym = keySym->Children;
+	if(!symbol->Name)
+	{
+		symbol->Name = rp_CopyFoldedName(ini, symbol, name);
 
-			if(valueSym && valueSym->Type == SYM_Key)
-				*symbolOut = valueSym;
-			else
-				r = rp_SetLastError(ORP_ERR_INI_MISSING_KEYVALUE, " Section name = %s, Key name = %s.", section, key);
+		if(symbol->Name)
+		{
+			names->Slots[i].Name = symbol->Name;
+			names->Slots[i].Length = symbol->Length;
+			names->Slots[i].Hash = symbol->Hash;
+			names->Count++;
 		}
-		else
-			r = rp_SetLastError(ORP_ERR_INI_KEYNOTFOUND, " Section name = %s, Key name = %s.", section, key);
 	}
 
-	return r;
+	return symbol->Name != NULL;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_IniSymbol *rp_ReadSection(S_ParseContext *context, S_IniSymbol *currentSymbol)
+bool rp_PrepareName(S_Ini *ini, S_NamePool *names, S_IniSymbol *symbol)
 {
-	S_IniSymbol *symbol = NULL;
-	int64_t bracketOffset = rp_FindChar(context, ']', context->CurrentOffset, -1, true);
-
-	if(bracketOffset < 0)
-		rp_SetParseError(context, ORP_ERR_INI_INVALID_SECTION, true, "");
-	else
+	// case fold names once so that lookups compare them with memcmp, key names are interned
+	// since they repeat from section to section, section names are usually unique
+	if(ini->Config.KeysCaseInsensitive)
 	{
-		symbol = rp_CreateAddSymbol(context, &currentSymbol, SYM_SectionName, context->CurrentOffset + 1, bracketOffset - 1);
+		S_IniName name;
+		rp_InitializeName(&name, symbol->Value, symbol->Length, &ini->Config);
+		symbol->Hash = name.Hash;
 
-		if(symbol)
-			context->CurrentOffset = bracketOffset + 1;
-		else
-			rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+		if(names)
+			return rp_InternName(ini, names, symbol, &name);
+
+		symbol->Name = rp_CopyFoldedName(ini, symbol, &name);
+		return symbol->Name != NULL;
 	}
 
-	return symbol;
+	symbol->Hash = rp_HashString(symbol->Value, symbol->Length, false);
+	symbol->Name = symbol->Value;
+
+	return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_ReadKey(S_ParseContext *context, S_IniSymbol *parentSymbol)
+void rp_IndexInsert(S_IniIndex *index, S_IniSymbol *symbol, S_IniConfig *config)
 {
-	// TODO: Doesn't handle case of comment in key name (ie, "Version;=4")
+	uint32_t i = symbol->Hash & index->Mask;
+	bool inserted = false;
 
-	int64_t eqOffset = rp_FindChar(context, '=', context->CurrentOffset, -1, true);
-
-	if(eqOffset < 0)
-		rp_SetParseError(context, ORP_ERR_INI_MISSING_KEYVALUE, true, ""); // missing "=" symbol
-	else if(eqOffset - context->CurrentOffset == 0)
-		rp_SetParseError(context, ORP_ERR_INI_INVALID_KEYNAME, true, "");  // "=" present, but no key name precedes it
-	else
+	while(index->Slots[i] && !inserted)
 	{
-		S_Offset keyOffset = rp_MakeOffset(context->CurrentOffset, eqOffset - 1);
-		rp_Trim(context, &keyOffset);
+		S_IniSymbol *s = index->Slots[i];
 
-		S_IniSymbol *symbol = rp_CreateAddSymbol(context, &parentSymbol->Children, SYM_KeyName, keyOffset.Start, keyOffset.End);
-
-		if(symbol)
+		if(s->Hash == symbol->Hash && s->Length == symbol->Length && memcmp(s->Name, symbol->Name, s->Length) == 0)
 		{
-			S_Offset valueOffset;
-			rp_SetOffset(&valueOffset, eqOffset + 1, rp_FindNewLine(context, eqOffset + 1, &valueOffset) ? valueOffset.Start - 1 : context->DataLength - 1);
-
-			if(context->Config.TrimKeyValues)
-				rp_Trim(context, &valueOffset);
-
-			if(valueOffset.Count > 0 && rp_IsPrintable(context->Data[valueOffset.Start]) && context->Data[valueOffset.Start] != ' ')
-				symbol = rp_CreateAddSymbol(context, &symbol->Children, SYM_Key, valueOffset.Start, valueOffset.End);		 
+			// duplicate name, the first one wins when ignoring duplicates, the last one when overwriting
+			if(config->DuplicateMode == IniDuplicateMode_Overwrite)
+			{
+				s->Shadowed = true;
+				index->Slots[i] = symbol;
+			}
 			else
-				symbol = rp_AddSymbol(context, &symbol->Children, rp_CreateEmptySymbol(SYM_Key)); // blank key i.e. KEY=
+				symbol->Shadowed = true;
 
-			if(symbol)
-				context->CurrentOffset = valueOffset.End + 1;
-			else
-				rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+			inserted = true;
 		}
 		else
-			rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+			i = (i + 1) & index->Mask;
 	}
+
+	if(!inserted)
+		index->Slots[i] = symbol;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-S_Ini *rp_ParseIni(S_IniConfig *config, unsigned char *data, int64_t dataLength)
+S_IniSymbol *rp_IndexFind(S_IniIndex *index, S_IniName *name)
 {
-	S_IniSymbol *lastSection = NULL, *firstSection = NULL;
-	S_ParseContext context;
-
-	rp_InitializeContext(&context, config, data, dataLength);
-	rp_SkipWhiteSpace(&context);
+	S_IniSymbol *symbol = NULL;
 
-	while(context.CurrentOffset < dataLength && rpGetLastError() == ORP_ERR_NO_ERROR)
+	if(index && index->Slots)
 	{
-		char c = rp_PeekChar(&context);
+		uint32_t i = name->Hash & index->Mask;
 
-		if(c == ';')
-			rp_NextLine(&context);
-		else
+		while(index->Slots[i] && !symbol)
 		{
-			if(c == '[')
-				lastSection = rp_ReadSection(&context, lastSection);
-			else if(lastSection && rp_IsPrintable(c))
-				rp_ReadKey(&context, lastSection);
-			else
-				rp_SetParseError(&context, ORP_ERR_INI_INVALID_SYMBOL, true, "");
+			S_IniSymbol *s = index->Slots[i];
 
-			if(lastSection != NULL && firstSection == NULL)
-				firstSection = lastSection;
+			if(rp_NameEquals(s->Name, s->Length, s->Hash, name))
+				symbol = s;
+			else
+				i = (i + 1) & index->Mask;
 		}
-
-		rp_SkipWhiteSpace(&context);
 	}
 
-	return rp_CreateIni(&context.Config, firstSection, lastSection, rpGetLastError(), NULL);
+	return symbol;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
 ///
 ///
 /////////////////////////////////////////////////////////////////////////////////
-void rp_IniClose(ORP_HANDLE hIni)
+ORP_ERR rp_BuildKeyIndex(S_Ini *ini, S_NamePool *names, S_IniSymbol *sectionSym)
 {
-	assert(hIni != NULL);
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	size_t numKeys = 0;
+	bool named = true;
+
+	for(S_IniSymbol *keySym = sectionSym->Children; keySym && named; keySym = keySym->NextSymbol)
+	{
+		named = rp_PrepareName(ini, names, keySym);
+		numKeys++;
+	}
+
+	sectionSym->KeyIndex = named ? rp_ArenaAlloc(&ini->Arena, sizeof(S_IniIndex)) : NULL;
+
+	if(sectionSym->KeyIndex && rp_CreateIndex(&ini->Arena, sectionSym->KeyIndex, numKeys))
+	{
+		for(S_IniSymbol *keySym = sectionSym->Children; keySym; keySym = keySym->NextSymbol)
+			rp_IndexInsert(sectionSym->KeyIndex, keySym, &ini->Config);
+	}
+	else
+		r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_BuildIndex(S_Ini *ini)
+{
+	// index section and key names once after parsing so lookups don't have to walk the symbol lists
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	size_t numSections = 0;
+	bool named = true;
+
+
+	for(S_IniSymbol *sectionSym = ini->FirstSection; sectionSym && named; sectionSym = sectionSym->NextSymbol)
+	{
+		named = rp_PrepareName(ini, NULL, sectionSym);
+		numSections++;
+	}
+
+	if(named && rp_CreateIndex(&ini->Arena, &ini->SectionIndex, numSections))
+	{
+		for(S_IniSymbol *sectionSym = ini->FirstSection; sectionSym; sectionSym = sectionSym->NextSymbol)
+			rp_IndexInsert(&ini->SectionIndex, sectionSym, &ini->Config);
+
+		// only sections that won over their duplicates can be found, the others don't need a key index
+		// lazy sections get theirs when they are parsed
+		for(uint32_t i = 0; i <= ini->SectionIndex.Mask && r == ORP_ERR_NO_ERROR; i++)
+		{
+			if(ini->SectionIndex.Slots[i] && !ini->SectionIndex.Slots[i]->Lazy)
+				r = rp_BuildKeyIndex(ini, &ini->Names, ini->SectionIndex.Slots[i]);
+		}
+	}
+	else
+		r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+	// names are interned while indexing, the pool itself isn't needed afterwards unless sections are parsed later
+	if(!ini->Config.LazySections)
+	{
+		rp_free(ini->Names.Slots);
+		ini->Names.Slots = NULL;
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const S_SnapshotSection *rp_SnapshotFindSection(const S_SnapshotHeader *snapshot, S_IniName *section)
+{
+	const unsigned char *image = (const unsigned char *)snapshot;
+	const uint32_t *slots = (const uint32_t *)(image + snapshot->SectionSlots);
+	const S_SnapshotSection *sections = (const S_SnapshotSection *)(image + snapshot->Sections);
+	const char *strings = (const char *)image + snapshot->Strings;
+	const S_SnapshotSection *entry = NULL;
+	uint32_t i = section->Hash & snapshot->SectionMask;
+
+	while(slots[i] && !entry)
+	{
+		const S_SnapshotSection *e = &sections[slots[i] - 1];
+
+		if(rp_NameEquals(strings + e->LookupName, e->NameLength, e->Hash, section))
+			entry = e;
+		else
+			i = (i + 1) & snapshot->SectionMask;
+	}
+
+	return entry;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const S_SnapshotKey *rp_SnapshotFindKey(const S_SnapshotHeader *snapshot, const S_SnapshotSection *section, S_IniName *key)
+{
+	const unsigned char *image = (const unsigned char *)snapshot;
+	const uint32_t *slots = (const uint32_t *)(image + snapshot->KeySlots) + section->FirstSlot;
+	const S_SnapshotKey *keys = (const S_SnapshotKey *)(image + snapshot->Keys) + section->FirstKey;
+	const char *strings = (const char *)image + snapshot->Strings;
+	const S_SnapshotKey *entry = NULL;
+	uint32_t i = key->Hash & section->SlotMask;
+
+	while(slots[i] && !entry)
+	{
+		const S_SnapshotKey *e = &keys[slots[i] - 1];
+
+		if(rp_NameEquals(strings + e->LookupName, e->NameLength, e->Hash, key))
+			entry = e;
+		else
+			i = (i + 1) & section->SlotMask;
+	}
+
+	return entry;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_FindSection(S_Ini *ini, const char *section, S_IniSection *sectionOut)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	S_IniSection found = { 0 };
+	S_IniName name;
+
+	rp_InitializeName(&name, section, strlen(section), &ini->Config);
+
+	if(ini->Snapshot)
+		found.Entry = rp_SnapshotFindSection(ini->Snapshot, &name);
+	else
+		found.Symbol = rp_IndexFind(&ini->SectionIndex, &name);
+
+	if((found.Symbol && found.Symbol->Type == SYM_SectionName) || found.Entry)
+		*sectionOut = found;
+	else
+		r = rp_SetLastError(ORP_ERR_INI_SECTION_NOT_FOUND, " Section name = %s.", section);
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+const char *rp_ValueString(S_Ini *ini, S_IniValue *value)
+{
+	return value->Symbol ? rp_SymbolString(ini, value->Symbol) : value->Value;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadSection(S_ParseContext *context)
+{
+	int64_t bracketOffset = rp_FindChar(context, ']', context->CurrentOffset, -1);
+
+	if(bracketOffset < 0)
+		rp_SetParseError(context, ORP_ERR_INI_INVALID_SECTION, true, "");
+	else
+	{
+		S_Offset nameOffset = rp_MakeOffset(context->CurrentOffset + 1, bracketOffset - 1);
+
+		if(context->Handler.Section(context, &nameOffset))
+		{
+			context->CurrentOffset = bracketOffset + 1;
+			context->InSection = true;
+		}
+		else
+			context->Stop = true;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReadKey(S_ParseContext *context)
+{
+	// TODO: Doesn't handle case of comment in key name (ie, "Version;=4")
+
+	int64_t eqOffset = rp_FindChar(context, '=', context->CurrentOffset, -1);
+
+	if(eqOffset < 0)
+		rp_SetParseError(context, ORP_ERR_INI_MISSING_KEYVALUE, true, ""); // missing "=" symbol
+	else if(eqOffset - context->CurrentOffset == 0)
+		rp_SetParseError(context, ORP_ERR_INI_INVALID_KEYNAME, true, "");  // "=" present, but no key name precedes it
+	else
+	{
+		S_Offset keyOffset = rp_MakeOffset(context->CurrentOffset, eqOffset - 1);
+		rp_Trim(context, &keyOffset);
+
+		S_Offset valueOffset;
+		rp_SetOffset(&valueOffset, eqOffset + 1, rp_FindNewLine(context, eqOffset + 1, &valueOffset) ? valueOffset.Start - 1 : context->DataLength - 1);
+
+		if(context->Config.TrimKeyValues)
+			rp_Trim(context, &valueOffset);
+
+		bool hasValue = valueOffset.Count > 0 && rp_IsPrintable(context->Data[valueOffset.Start]) && context->Data[valueOffset.Start] != ' ';
+
+		if(context->Handler.Key(context, &keyOffset, hasValue ? &valueOffset : NULL))
+			context->CurrentOffset = valueOffset.End + 1;
+		else
+			context->Stop = true;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_Tokenize(S_ParseContext *context)
+{
+	rp_SkipWhiteSpace(context);
+
+	while(context->CurrentOffset < context->DataLength && !context->Stop && rpGetLastError() == ORP_ERR_NO_ERROR)
+	{
+		char c = rp_PeekChar(context);
+
+		if(c == ';')
+			rp_NextLine(context);
+		else
+		{
+			if(c == '[')
+				rp_ReadSection(context);
+			else if(context->InSection && rp_IsPrintable(c))
+			{
+				if(context->Handler.Key)
+					rp_ReadKey(context);
+				else
+					rp_NextLine(context);
+			}
+			else
+				rp_SetParseError(context, ORP_ERR_INI_INVALID_SYMBOL, true, "");
+		}
+
+		if(!context->Stop)
+			rp_SkipWhiteSpace(context);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_TreeAddSection(S_ParseContext *context, S_Offset *name)
+{
+	S_TreeBuilder *tree = context->Handler.UserPtr;
+	S_IniSymbol *symbol = rp_CreateAddSymbol(context, &tree->FirstSection, &tree->LastSection, SYM_SectionName, name->Start, name->End);
+
+	if(!symbol)
+		rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+
+	return symbol != NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_TreeAddKey(S_ParseContext *context, S_Offset *key, S_Offset *value)
+{
+	S_TreeBuilder *tree = context->Handler.UserPtr;
+	S_IniSymbol *section = tree->LastSection;
+	S_IniSymbol *symbol = rp_CreateAddSymbol(context, &section->Children, &section->LastChild, SYM_KeyName, key->Start, key->End);
+
+	if(symbol)
+	{
+		if(value)
+			symbol = rp_CreateAddSymbol(context, &symbol->Children, &symbol->LastChild, SYM_Key, value->Start, value->End);
+		else
+			symbol = rp_AddSymbol(context, &symbol->Children, &symbol->LastChild, rp_CreateEmptySymbol(&context->Arena, SYM_Key)); // blank key i.e. KEY=
+	}
+
+	if(!symbol)
+		rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+
+	return symbol != NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_LazyAddSection(S_ParseContext *context, S_Offset *name)
+{
+	// a section's keys run from its header to the next one, name is between the brackets
+	S_TreeBuilder *tree = context->Handler.UserPtr;
+	S_IniSymbol *previous = tree->LastSection;
+	S_LazySection *lazy = NULL;
+
+	if(rp_TreeAddSection(context, name))
+	{
+		lazy = rp_ArenaAllocZ(&context->Arena, sizeof(S_LazySection));
+
+		if(lazy)
+		{
+			lazy->Start = name->End + 2;
+			lazy->End = context->DataLength;
+			lazy->Line = context->CurrentLine;
+			tree->LastSection->Lazy = lazy;
+
+			if(previous)
+				previous->Lazy->End = name->Start - 1;
+		}
+		else
+			rp_SetParseError(context, ORP_ERR_MEM_ALLOC, false, "");
+	}
+
+	return lazy != NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_LoadLazySection(S_Ini *ini, S_IniSymbol *sectionSym)
+{
+	// tokenize the keys of a lazy section the first time it's looked up, a section
+	// that fails to parse reports the same error on every later lookup
+	S_LazySection *lazy = sectionSym->Lazy;
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+
+	if(lazy && lazy->Error != ORP_ERR_NO_ERROR)
+	{
+		r = rp_SetLastError(lazy->Error, "");
+		rp_AppendLastError(" Line: %d.", lazy->ErrorLine + 1);
+	}
+	else if(lazy)
+	{
+		S_TreeBuilder tree = { sectionSym, sectionSym };
+		S_ParseContext context;
+
+		memset(&context, 0, sizeof(S_ParseContext));
+		context.Data = ini->Source;
+		context.DataLength = lazy->End;
+		context.CurrentOffset = lazy->Start;
+		context.CurrentLine = lazy->Line;
+		context.Config = ini->Config;
+		context.Arena = ini->Arena; // symbols are added to the INI's arena, it's handed back below
+		context.Handler.Section = rp_TreeAddSection;
+		context.Handler.Key = rp_TreeAddKey;
+		context.Handler.UserPtr = &tree;
+		context.InSection = true;
+
+		rp_Tokenize(&context);
+
+		ini->Arena = context.Arena;
+		r = rpGetLastError();
+
+		if(r == ORP_ERR_NO_ERROR)
+			r = rp_BuildKeyIndex(ini, &ini->Names, sectionSym);
+
+		if(r == ORP_ERR_NO_ERROR)
+			sectionSym->Lazy = NULL;
+		else
+		{
+			// drop what was parsed, allocation failures are retried on the next lookup
+			sectionSym->Children = NULL;
+			sectionSym->LastChild = NULL;
+			sectionSym->KeyIndex = NULL;
+
+			if(r != ORP_ERR_MEM_ALLOC)
+			{
+				lazy->Error = r;
+				lazy->ErrorLine = context.CurrentLine;
+			}
+		}
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_FindKey(S_Ini *ini, const char *section, const char *key, S_IniValue *valueOut)
+{
+	S_IniSection sectionRef;
+	S_IniName name;
+	ORP_ERR r = rp_FindSection(ini, section, &sectionRef);
+
+	if(r == ORP_ERR_NO_ERROR)
+		rp_InitializeName(&name, key, strlen(key), &ini->Config);
+
+	if(r == ORP_ERR_NO_ERROR && sectionRef.Entry)
+	{
+		const S_SnapshotKey *entry = rp_SnapshotFindKey(ini->Snapshot, sectionRef.Entry, &name);
+
+		if(entry)
+		{
+			valueOut->Value = (const char *)ini->Snapshot + ini->Snapshot->Strings + entry->Value;
+			valueOut->Length = entry->ValueLength;
+			valueOut->Symbol = NULL;
+			valueOut->Key = (uint32_t)(entry - (const S_SnapshotKey *)((const unsigned char *)ini->Snapshot + ini->Snapshot->Keys));
+		}
+		else
+			r = rp_SetLastError(ORP_ERR_INI_KEYNOTFOUND, " Section name = %s, Key name = %s.", section, key);
+	}
+	else if(r == ORP_ERR_NO_ERROR && (r = rp_LoadLazySection(ini, sectionRef.Symbol)) == ORP_ERR_NO_ERROR)
+	{
+		S_IniSymbol *keySym = rp_IndexFind(sectionRef.Symbol->KeyIndex, &name);
+
+		if(keySym && keySym->Type == SYM_KeyName)
+		{
+			S_IniSymbol *valueSym = keySym->Children;
+
+			if(valueSym && valueSym->Type == SYM_Key)
+			{
+				valueOut->Value = valueSym->Value;
+				valueOut->Length = valueSym->Length;
+				valueOut->Symbol = valueSym;
+			}
+			else
+				r = rp_SetLastError(ORP_ERR_INI_MISSING_KEYVALUE, " Section name = %s, Key name = %s.", section, key);
+		}
+		else
+			r = rp_SetLastError(ORP_ERR_INI_KEYNOTFOUND, " Section name = %s, Key name = %s.", section, key);
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_IniTypedValue *volatile *rp_TypedValueSlot(S_Ini *ini, S_IniValue *value, bool create)
+{
+	// parsed forms hang off the value symbol, snapshot keys have no symbol and use a table by key index instead
+	if(value->Symbol)
+		return &value->Symbol->Typed;
+
+	S_IniTypedValue *volatile *table = rp_AtomicLoadPointer((void *volatile *)&ini->SnapshotTyped);
+
+	if(!table && create)
+	{
+		table = rp_ArenaAllocZ(&ini->Arena, ini->Snapshot->NumKeys * sizeof(S_IniTypedValue *));
+		rp_AtomicStorePointer((void *volatile *)&ini->SnapshotTyped, (void *)table);
+	}
+
+	return table ? &table[value->Key] : NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_IniTypedValue *rp_GetTypedValue(S_Ini *ini, S_IniValue *value)
+{
+	// readers of shared INIs may race with the thread that creates the parsed forms, which is
+	// serialized by S_Ini::Lock, so pointers are published with release and read with acquire
+	S_IniTypedValue *volatile *slot = rp_TypedValueSlot(ini, value, false);
+	return slot ? rp_AtomicLoadPointer((void *volatile *)slot) : NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_IniTypedValue *rp_CreateTypedValue(S_Ini *ini, S_IniValue *value)
+{
+	S_IniTypedValue *volatile *slot = rp_TypedValueSlot(ini, value, true);
+	S_IniTypedValue *typed = slot ? rp_AtomicLoadPointer((void *volatile *)slot) : NULL;
+
+	if(slot && !typed)
+	{
+		typed = rp_ArenaAllocZ(&ini->Arena, sizeof(S_IniTypedValue));
+		rp_AtomicStorePointer((void *volatile *)slot, typed);
+	}
+
+	if(!typed)
+		rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+	return typed;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ParseInt(const char *str, size_t length, int *value)
+{
+	// str must be NUL-terminated at length
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	char *e = NULL;
+
+	errno = 0;
+	long v = strtol(str, &e, 0);
+
+	if((size_t)(e - str) != length)
+		r = rp_SetLastError(ORP_ERR_BAD_ARG, " Not an integer: %s", str);
+	else if(errno == ERANGE || v > INT_MAX || v < INT_MIN)
+		r = rp_SetLastError(ORP_ERR_BAD_RANGE, " Value = %s", str);
+	else
+		*value = (int)v;
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ParseBool(const char *str, size_t length, bool *value)
+{
+	static const char *trueNames[] = { "1", "true", "yes", "on" };
+	static const char *falseNames[] = { "0", "false", "no", "off" };
+	bool found = false;
+
+	for(size_t i = 0; i < sizeof(trueNames) / sizeof(trueNames[0]) && !found; i++)
+	{
+		if(rp_IniViewEquals(str, length, trueNames[i], false))
+		{
+			*value = true;
+			found = true;
+		}
+		else if(rp_IniViewEquals(str, length, falseNames[i], false))
+		{
+			*value = false;
+			found = true;
+		}
+	}
+
+	return found ? ORP_ERR_NO_ERROR : rp_SetLastError(ORP_ERR_BAD_ARG, " Not a boolean: %.*s", (int)length, str);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_SplitList(S_Ini *ini, S_IniValue *value, char ***items, size_t *numItems)
+{
+	// copies the value with its commas replaced by NULs, items are trimmed of spaces and empty items are skipped
+	size_t maxItems = 1;
+	for(size_t i = 0; i < value->Length; i++)
+		maxItems += value->Value[i] == ',';
+
+	char *copy = rp_ArenaAlloc(&ini->Arena, value->Length + 1);
+	char **list = rp_ArenaAlloc(&ini->Arena, maxItems * sizeof(char *));
+	size_t count = 0;
+
+	if(!copy || !list)
+		return rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+	memcpy(copy, value->Value, value->Length);
+	copy[value->Length] = 0;
+
+	for(char *item = copy; item; )
+	{
+		char *comma = strchr(item, ',');
+		char *end = comma ? comma : item + strlen(item);
+
+		while(item < end && *item == ' ')
+			item++;
+		while(end > item && end[-1] == ' ')
+			end--;
+
+		*end = 0;
+		if(item < end)
+			list[count++] = item;
+
+		item = comma ? comma + 1 : NULL;
+	}
+
+	*items = list;
+	*numItems = count;
+
+	return ORP_ERR_NO_ERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ParseTypedValue(S_Ini *ini, S_IniValue *value, unsigned int type, S_IniTypedValue *typed)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+
+	if(type == TYPED_INT)
+	{
+		const char *str = rp_ValueString(ini, value);
+		r = str ? rp_ParseInt(str, value->Length, &typed->Int) : rpGetLastError();
+	}
+	else if(type == TYPED_BOOL)
+		r = rp_ParseBool(value->Value, value->Length, &typed->Bool);
+	else
+	{
+		char **items = NULL;
+		size_t numItems = 0;
+
+		r = rp_SplitList(ini, value, &items, &numItems);
+
+		if(r == ORP_ERR_NO_ERROR && type == TYPED_INT_LIST)
+		{
+			int *ints = rp_ArenaAlloc(&ini->Arena, (numItems > 0 ? numItems : 1) * sizeof(int));
+
+			if(!ints)
+				r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+
+			for(size_t i = 0; i < numItems && r == ORP_ERR_NO_ERROR; i++)
+				r = rp_ParseInt(items[i], strlen(items[i]), &ints[i]);
+
+			typed->Ints = ints;
+			typed->NumInts = numItems;
+		}
+		else if(r == ORP_ERR_NO_ERROR)
+		{
+			typed->Strings = (const char **)items;
+			typed->NumStrings = numItems;
+		}
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_FindTypedValue(ORP_HANDLE hIni, const char *section, const char *key, unsigned int type, S_IniTypedValue **typedOut)
+{
+	// looks up a key and parses the requested form of its value unless an earlier call already did
+	S_Ini *ini = rp_HandleToTarget(hIni);
+	S_IniValue value;
+	S_IniTypedValue *typed = NULL;
+
+	ORP_ERR r = rp_FindKey(ini, section, key, &value);
+
+	if(r == ORP_ERR_NO_ERROR)
+		typed = rp_GetTypedValue(ini, &value);
+
+	if(r == ORP_ERR_NO_ERROR && (!typed || !(rp_AtomicLoad(&typed->Parsed) & type)))
+	{
+		// only one thread at a time parses values of a shared INI, failures aren't cached
+		// and are reported again by parsing again
+		if(ini->Shared)
+			rp_SpinLock(&ini->Lock);
+
+		typed = rp_CreateTypedValue(ini, &value);
+
+		if(!typed)
+			r = rpGetLastError();
+		else if(!(typed->Parsed & type) && (r = rp_ParseTypedValue(ini, &value, type, typed)) == ORP_ERR_NO_ERROR)
+			rp_AtomicStore(&typed->Parsed, typed->Parsed | type);
+
+		if(ini->Shared)
+			rp_SpinUnlock(&ini->Lock);
+	}
+
+	*typedOut = typed;
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_DestroyIni(S_Ini *ini)
+{
+	rp_ArenaFree(&ini->Arena); // releases the whole symbol tree
+	rp_free(ini->Names.Slots);
+
+	if(ini->hMap)
+		rpFreeHandle(ini->hMap);
+
+	rp_free(ini->Data);
+	rp_free(ini);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int rp_ParseChunkCount(int64_t dataLength)
+{
+	unsigned int numChunks = 1;
+
+	if(dataLength >= PARALLEL_PARSE_MIN_SIZE)
+	{
+		int64_t maxChunks = dataLength / PARALLEL_PARSE_MIN_CHUNK;
+		numChunks = rp_GetProcessorCount();
+
+		if(numChunks > PARALLEL_PARSE_MAX_CHUNKS)
+			numChunks = PARALLEL_PARSE_MAX_CHUNKS;
+		if(numChunks > maxChunks)
+			numChunks = (unsigned int)maxChunks;
+	}
+
+	return numChunks;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_TokenizeChunk(void *userPtr, unsigned int index)
+{
+	S_ParseChunk *chunk = (S_ParseChunk *)userPtr + index;
+
+	// a worker may already have tokenized another chunk, its error must not stop this one
+	rp_ClearLastError();
+	rp_Tokenize(&chunk->Context);
+	chunk->Error = rpGetLastError();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Ini *rp_ParseChunks(S_IniConfig *config, const unsigned char *data, int64_t dataLength, unsigned int numChunks)
+{
+	// a line starting with '[' is always a section header, so the file can be cut in
+	// front of one and each part tokenized without knowing what came before it
+	S_ParseChunk chunks[PARALLEL_PARSE_MAX_CHUNKS];
+	unsigned int count = 0;
+	int64_t start = 0;
+
+	assert(numChunks <= PARALLEL_PARSE_MAX_CHUNKS);
+
+	while(start < dataLength)
+	{
+		int64_t end = dataLength;
+
+		if(count + 1 < numChunks)
+		{
+			int64_t target = dataLength / numChunks * (count + 1);
+			const unsigned char *nl = target > start ? data + target : data + start;
+
+			while((nl = memchr(nl, LINE_FEED, (size_t)(data + dataLength - nl))) != NULL && nl + 1 < data + dataLength && nl[1] != '[')
+				nl++;
+
+			if(nl && nl + 1 < data + dataLength)
+				end = nl + 1 - data;
+		}
+
+		S_ParseChunk *chunk = &chunks[count++];
+		chunk->Tree.FirstSection = NULL;
+		chunk->Tree.LastSection = NULL;
+		chunk->Error = ORP_ERR_NO_ERROR;
+
+		rp_InitializeContext(&chunk->Context, config, data, start, end);
+		chunk->Context.Handler.Section = rp_TreeAddSection;
+		chunk->Context.Handler.Key = rp_TreeAddKey;
+		chunk->Context.Handler.UserPtr = &chunk->Tree;
+
+		start = end;
+	}
+
+	rp_ParallelFor(count, count, rp_TokenizeChunk, chunks);
+
+	// stitch the section lists together in file order, the first chunk that failed
+	// reports its error with the line number counted from the start of the file
+	S_TreeBuilder tree = { 0 };
+	S_Arena arena = chunks[0].Context.Arena;
+	ORP_ERR error = ORP_ERR_NO_ERROR;
+	unsigned int line = 0;
+
+	for(unsigned int i = 0; i < count; i++)
+	{
+		S_ParseChunk *chunk = &chunks[i];
+
+		if(i > 0)
+			rp_ArenaAdopt(&arena, &chunk->Context.Arena);
+
+		if(error != ORP_ERR_NO_ERROR)
+			continue;
+
+		if(chunk->Error != ORP_ERR_NO_ERROR)
+		{
+			error = rp_SetLastError(chunk->Error, "");
+
+			if(error != ORP_ERR_MEM_ALLOC)
+				rp_AppendLastError(" Line: %d.", line + chunk->Context.CurrentLine + 1);
+		}
+		else if(chunk->Tree.FirstSection)
+		{
+			if(tree.LastSection)
+			{
+				tree.LastSection->NextSymbol = chunk->Tree.FirstSection;
+				chunk->Tree.FirstSection->PrevSymbol = tree.LastSection;
+			}
+			else
+				tree.FirstSection = chunk->Tree.FirstSection;
+
+			tree.LastSection = chunk->Tree.LastSection;
+		}
+
+		line += chunk->Context.CurrentLine;
+	}
+
+	return rp_CreateIni(&chunks[0].Context.Config, &arena, tree.FirstSection, tree.LastSection, error, NULL);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Ini *rp_ParseIni(S_IniConfig *config, const unsigned char *data, int64_t dataLength)
+{
+	S_TreeBuilder tree = { 0 };
+	S_ParseContext context;
+
+	rp_InitializeContext(&context, config, data, 0, dataLength);
+	context.Handler.Section = rp_TreeAddSection;
+	context.Handler.Key = rp_TreeAddKey;
+	context.Handler.UserPtr = &tree;
+
+	if(context.Config.LazySections)
+	{
+		// only section headers are read now, the arena grows as sections are parsed
+		rp_ArenaInit(&context.Arena, 0);
+		context.Handler.Section = rp_LazyAddSection;
+		context.Handler.Key = NULL;
+	}
+
+	S_Ini *ini;
+	unsigned int numChunks = context.Config.LazySections ? 1 : rp_ParseChunkCount(dataLength);
+
+	if(numChunks > 1)
+		ini = rp_ParseChunks(&context.Config, data, dataLength, numChunks);
+	else
+	{
+		rp_Tokenize(&context);
+		ini = rp_CreateIni(&context.Config, &context.Arena, tree.FirstSection, tree.LastSection, rpGetLastError(), NULL);
+	}
+
+	if(ini)
+		ini->Source = data;
+
+	if(ini && rp_BuildIndex(ini) != ORP_ERR_NO_ERROR)
+	{
+		rp_DestroyIni(ini);
+		ini = NULL;
+	}
+
+	return ini;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ReleaseSharedIni(S_Ini *ini)
+{
+	// the last handle unregisters the INI, so no other thread can find it while it's freed
+	rp_SpinLock(&gSharedLock);
+
+	bool last = --ini->RefCount == 0;
+
+	for(S_Ini **link = &gSharedInis; last && *link; link = &(*link)->NextShared)
+	{
+		if(*link == ini)
+		{
+			*link = ini->NextShared;
+			break;
+		}
+	}
+
+	rp_SpinUnlock(&gSharedLock);
+
+	if(last)
+		rp_DestroyIni(ini);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_IniClose(ORP_HANDLE hIni)
+{
+	assert(hIni != NULL);
 	S_Ini *ini = rp_HandleToTarget(hIni);
 
-	rp_DestroySymbol(ini->FirstSection);
-	rp_free(ini);
+	if(ini->Shared)
+		rp_ReleaseSharedIni(ini);
+	else
+		rp_DestroyIni(ini);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_CloseIniSource(S_IniSource *source)
+{
+	if(source->hMap)
+		rpFreeHandle(source->hMap);
+
+	rp_free(source->Buffer);
+	memset(source, 0, sizeof(S_IniSource));
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_ReadIniSource(const char *iniPath, S_IniSource *source)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	enum { ERRLEN = 512 };
+	char errBuf[ERRLEN];
+
+	memset(errBuf, 0, ERRLEN);
+	uint64_t fileSizeFull = rp_GetFileSize(iniPath);
+
+	if((r = rpGetLastError()) == ORP_ERR_NO_ERROR)
+	{
+		if(fileSizeFull >= 0 && fileSizeFull <= SIZE_MAX)
+		{
+			size_t fileSize = (size_t)fileSizeFull;
+			unsigned char *data = rp_malloc(fileSize);
+
+			if(data)
+			{
+				FILE *fp = fopen(iniPath, "rb");
+
+				if(fp)
+				{
+					if(fread(data, 1, fileSize, fp) != fileSize)
+						r = rp_SetLastError(ORP_ERR_FILE_IO, "Failed to read from file.");
+
+					fclose(fp);
+				}
+				else
+					r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, rp_Concat(errBuf, ERRLEN, "File: %s", iniPath));
+
+				if(r == ORP_ERR_NO_ERROR)
+				{
+					source->Data = source->Buffer = data;
+					source->DataLength = (int64_t)fileSize;
+				}
+				else
+					rp_free(data);
+			}
+			else
+				r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+		}
+		else
+			r = rp_SetLastError(ORP_ERR_FILE_NOT_FOUND, rp_Concat(errBuf, ERRLEN, "File: %s", iniPath));
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_MapIniSource(const char *iniPath, S_IniSource *source)
+{
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+	enum { ERRLEN = 512 };
+	char errBuf[ERRLEN];
+	ORP_HANDLE hMap = rp_MapFile(iniPath);
+
+	if(hMap)
+	{
+		uint64_t fileSizeFull = 0;
+		const unsigned char *data = rp_GetMappedFileData(hMap, &fileSizeFull);
+
+		if(fileSizeFull <= SIZE_MAX && fileSizeFull <= INT64_MAX)
+		{
+			source->Data = data;
+			source->DataLength = (int64_t)fileSizeFull;
+			source->hMap = hMap;
+		}
+		else
+		{
+			r = rp_SetLastError(ORP_ERR_BAD_RANGE, rp_Concat(errBuf, ERRLEN, "File: %s", iniPath));
+			rpFreeHandle(hMap);
+		}
+	}
+	else
+		r = rpGetLastError();
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_OpenIniSource(const char *iniPath, S_IniConfig *config, S_IniSource *source)
+{
+	memset(source, 0, sizeof(S_IniSource));
+	return config->MemoryMapped ? rp_MapIniSource(iniPath, source) : rp_ReadIniSource(iniPath, source);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_SnapshotConfig(S_IniConfig *config)
+{
+	// parse options that change the symbol tree or lookups, a snapshot is only valid for the same ones
+	return (uint32_t)config->DuplicateMode | (config->TrimKeyValues ? 0x100 : 0) | (config->KeysCaseInsensitive ? 0x200 : 0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_SnapshotChecksum(const S_SnapshotHeader *header)
+{
+	return rp_HashString((const char *)header, offsetof(S_SnapshotHeader, Checksum), false);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+char *rp_SnapshotPath(const char *iniPath)
+{
+	size_t len = strlen(iniPath) + sizeof(SNAPSHOT_EXT);
+	char *path = rp_malloc(len);
+
+	if(path)
+		rp_Concat(path, len, "%s%s", iniPath, SNAPSHOT_EXT);
+
+	return path;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_SnapshotAddString(char *strings, uint32_t *stringsSize, const char *value, size_t length)
+{
+	uint32_t offset = *stringsSize;
+
+	memcpy(strings + offset, value, length);
+	strings[offset + length] = 0;
+	*stringsSize += (uint32_t)length + 1;
+
+	return offset;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t rp_SnapshotLookupNameSize(S_IniSymbol *symbol)
+{
+	// the lookup name only needs its own string when case folding changed it
+	return memcmp(symbol->Name, symbol->Value, symbol->Length) == 0 ? 0 : symbol->Length + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t rp_SnapshotAddLookupName(char *strings, uint32_t *stringsSize, S_IniSymbol *symbol, uint32_t name)
+{
+	return rp_SnapshotLookupNameSize(symbol) ? rp_SnapshotAddString(strings, stringsSize, symbol->Name, symbol->Length) : name;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SnapshotAddSlot(uint32_t *slots, uint32_t mask, uint32_t hash, uint32_t index)
+{
+	uint32_t i = hash & mask;
+
+	while(slots[i])
+		i = (i + 1) & mask;
+
+	slots[i] = index + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_IniSymbol *rp_NextEnumKey(S_Ini *ini, S_IniSymbol *keySym)
+{
+	return ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? keySym->NextSymbol : keySym->PrevSymbol;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned char *rp_BuildSnapshot(S_Ini *ini, S_FileInfo *source, uint32_t *imageSize)
+{
+	// only what lookups can resolve to goes into the snapshot: sections and keys that aren't shadowed
+	uint64_t numSections = 0, numKeys = 0, numKeySlots = 0, stringsSize = 0;
+	bool forward = ini->Config.DuplicateMode == IniDuplicateMode_Ignore;
+
+	for(S_IniSymbol *sectionSym = ini->FirstSection; sectionSym; sectionSym = sectionSym->NextSymbol)
+	{
+		if(!sectionSym->Shadowed)
+		{
+			uint64_t sectionKeys = 0;
+
+			for(S_IniSymbol *keySym = sectionSym->Children; keySym; keySym = keySym->NextSymbol)
+			{
+				if(keySym->Type == SYM_KeyName && !keySym->Shadowed && keySym->Children)
+				{
+					sectionKeys++;
+					stringsSize += keySym->Length + keySym->Children->Length + 2 + rp_SnapshotLookupNameSize(keySym);
+				}
+			}
+
+			numSections++;
+			numKeys += sectionKeys;
+			numKeySlots += rp_HashTableSize((size_t)sectionKeys);
+			stringsSize += sectionSym->Length + 1 + rp_SnapshotLookupNameSize(sectionSym);
+		}
+	}
+
+	uint32_t numSectionSlots = rp_HashTableSize((size_t)numSections);
+	uint64_t size = sizeof(S_SnapshotHeader) + numSectionSlots * sizeof(uint32_t) + numSections * sizeof(S_SnapshotSection)
+		+ numKeys * sizeof(S_SnapshotKey) + numKeySlots * sizeof(uint32_t) + stringsSize;
+
+	size = (size + sizeof(uint32_t) - 1) & ~(uint64_t)(sizeof(uint32_t) - 1); // whole words for the body checksum
+
+	unsigned char *image = size <= UINT32_MAX ? rp_mallocZ((size_t)size) : NULL;
+
+	if(image)
+	{
+		S_SnapshotHeader *header = (S_SnapshotHeader *)image;
+
+		header->Magic = SNAPSHOT_MAGIC;
+		header->Version = SNAPSHOT_VERSION;
+		header->HeaderSize = sizeof(S_SnapshotHeader);
+		header->ImageSize = (uint32_t)size;
+		header->Config = rp_SnapshotConfig(&ini->Config);
+		header->SourceSize = source->Size;
+		header->SourceTime = source->ModifiedTime;
+		header->SourceDevice = source->Device;
+		header->SourceInode = source->Inode;
+
+		header->SectionSlots = sizeof(S_SnapshotHeader);
+		header->SectionMask = numSectionSlots - 1;
+		header->Sections = header->SectionSlots + numSectionSlots * sizeof(uint32_t);
+		header->NumSections = (uint32_t)numSections;
+		header->Keys = header->Sections + header->NumSections * sizeof(S_SnapshotSection);
+		header->NumKeys = (uint32_t)numKeys;
+		header->KeySlots = header->Keys + header->NumKeys * sizeof(S_SnapshotKey);
+		header->NumKeySlots = (uint32_t)numKeySlots;
+		header->Strings = header->KeySlots + header->NumKeySlots * sizeof(uint32_t);
+		header->StringsSize = (uint32_t)stringsSize;
+
+		uint32_t *sectionSlots = (uint32_t *)(image + header->SectionSlots);
+		S_SnapshotSection *sections = (S_SnapshotSection *)(image + header->Sections);
+		S_SnapshotKey *keys = (S_SnapshotKey *)(image + header->Keys);
+		uint32_t *keySlots = (uint32_t *)(image + header->KeySlots);
+		char *strings = (char *)(image + header->Strings);
+		uint32_t sectionIndex = 0, keyIndex = 0, slotIndex = 0, stringsUsed = 0;
+
+		for(S_IniSymbol *sectionSym = ini->FirstSection; sectionSym; sectionSym = sectionSym->NextSymbol)
+		{
+			if(!sectionSym->Shadowed)
+			{
+				S_SnapshotSection *section = &sections[sectionIndex];
+
+				section->Name = rp_SnapshotAddString(strings, &stringsUsed, sectionSym->Value, sectionSym->Length);
+				section->NameLength = (uint32_t)sectionSym->Length;
+				section->LookupName = rp_SnapshotAddLookupName(strings, &stringsUsed, sectionSym, section->Name);
+				section->Hash = sectionSym->Hash;
+				section->FirstKey = keyIndex;
+				section->FirstSlot = slotIndex;
+
+				for(S_IniSymbol *keySym = forward ? sectionSym->Children : sectionSym->LastChild; keySym; keySym = rp_NextEnumKey(ini, keySym))
+				{
+					if(keySym->Type == SYM_KeyName && !keySym->Shadowed && keySym->Children)
+					{
+						S_SnapshotKey *key = &keys[keyIndex++];
+
+						key->Name = rp_SnapshotAddString(strings, &stringsUsed, keySym->Value, keySym->Length);
+						key->NameLength = (uint32_t)keySym->Length;
+						key->LookupName = rp_SnapshotAddLookupName(strings, &stringsUsed, keySym, key->Name);
+						key->Hash = keySym->Hash;
+						key->Value = rp_SnapshotAddString(strings, &stringsUsed, keySym->Children->Value, keySym->Children->Length);
+						key->ValueLength = (uint32_t)keySym->Children->Length;
+					}
+				}
+
+				section->NumKeys = keyIndex - section->FirstKey;
+				section->SlotMask = rp_HashTableSize(section->NumKeys) - 1;
+
+				for(uint32_t i = 0; i < section->NumKeys; i++)
+					rp_SnapshotAddSlot(keySlots + section->FirstSlot, section->SlotMask, keys[section->FirstKey + i].Hash, i);
+
+				rp_SnapshotAddSlot(sectionSlots, header->SectionMask, section->Hash, sectionIndex);
+
+				slotIndex += section->SlotMask + 1;
+				sectionIndex++;
+			}
+		}
+
+		header->BodyChecksum = rp_ImageBodyChecksum(image, sizeof(S_SnapshotHeader), header->ImageSize);
+		header->Checksum = rp_SnapshotChecksum(header);
+		*imageSize = header->ImageSize;
+	}
+
+	return image;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_SaveSnapshot(S_Ini *ini, const char *iniPath, S_FileInfo *source)
+{
+	// best effort, the INI directory may not be writable, failures only mean the next open parses the INI again
+	uint32_t imageSize = 0;
+	unsigned char *image = rp_BuildSnapshot(ini, source, &imageSize);
+	char *snapshotPath = rp_SnapshotPath(iniPath);
+
+	if(image && snapshotPath)
+		rp_SaveImage(snapshotPath, image, imageSize);
+
+	rp_free(snapshotPath);
+	rp_free(image);
+	rp_ClearLastError();
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_SnapshotString(const S_SnapshotHeader *header, uint32_t offset, uint32_t length)
+{
+	const char *strings = (const char *)header + header->Strings;
+	return offset < header->StringsSize && length < header->StringsSize - offset && strings[offset + length] == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_SnapshotSlots(const uint32_t *slots, uint32_t mask, uint32_t count)
+{
+	// a valid table has a free slot to end probing, and every used slot refers to one of count entries
+	uint32_t used = 0;
+
+	for(uint32_t i = 0; i <= mask; i++)
+	{
+		if(slots[i] > count)
+			return false;
+		else if(slots[i])
+			used++;
+	}
+
+	return used <= mask;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_ValidateSnapshot(const unsigned char *image, uint64_t imageSize, S_IniConfig *config, S_FileInfo *source)
+{
+	// the snapshot must describe the current INI with the current parse options and be structurally sound,
+	// lookups index into it without further checks
+	const S_SnapshotHeader *header = (const S_SnapshotHeader *)image;
+	bool valid = image && imageSize >= sizeof(S_SnapshotHeader) && imageSize <= UINT32_MAX;
+
+	valid = valid && header->Magic == SNAPSHOT_MAGIC && header->Version == SNAPSHOT_VERSION
+		&& header->HeaderSize == sizeof(S_SnapshotHeader) && header->ImageSize == imageSize
+		&& header->Checksum == rp_SnapshotChecksum(header) && header->Config == rp_SnapshotConfig(config)
+		&& header->SourceSize == source->Size && header->SourceTime == source->ModifiedTime
+		&& header->SourceDevice == source->Device && header->SourceInode == source->Inode
+		&& imageSize % sizeof(uint32_t) == 0
+		&& (!config->VerifySnapshot || header->BodyChecksum == rp_ImageBodyChecksum(image, sizeof(S_SnapshotHeader), header->ImageSize));
+
+	valid = valid && header->SectionMask < UINT32_MAX && ((header->SectionMask + 1) & header->SectionMask) == 0
+		&& rp_ImageRange(header->SectionSlots, (uint64_t)header->SectionMask + 1, sizeof(uint32_t), imageSize)
+		&& rp_ImageRange(header->Sections, header->NumSections, sizeof(S_SnapshotSection), imageSize)
+		&& rp_ImageRange(header->Keys, header->NumKeys, sizeof(S_SnapshotKey), imageSize)
+		&& rp_ImageRange(header->KeySlots, header->NumKeySlots, sizeof(uint32_t), imageSize)
+		&& rp_ImageRange(header->Strings, header->StringsSize, 1, imageSize)
+		&& rp_SnapshotSlots((const uint32_t *)(image + header->SectionSlots), header->SectionMask, header->NumSections);
+
+	const S_SnapshotSection *sections = (const S_SnapshotSection *)(image + header->Sections);
+	const S_SnapshotKey *keys = (const S_SnapshotKey *)(image + header->Keys);
+
+	for(uint32_t i = 0; valid && i < header->NumSections; i++)
+	{
+		const S_SnapshotSection *section = &sections[i];
+
+		valid = rp_SnapshotString(header, section->Name, section->NameLength) && rp_SnapshotString(header, section->LookupName, section->NameLength)
+			&& section->FirstKey <= header->NumKeys && section->NumKeys <= header->NumKeys - section->FirstKey
+			&& section->SlotMask < UINT32_MAX && ((section->SlotMask + 1) & section->SlotMask) == 0
+			&& section->FirstSlot <= header->NumKeySlots && section->SlotMask < header->NumKeySlots - section->FirstSlot
+			&& rp_SnapshotSlots((const uint32_t *)(image + header->KeySlots) + section->FirstSlot, section->SlotMask, section->NumKeys);
+	}
+
+	for(uint32_t i = 0; valid && i < header->NumKeys; i++)
+		valid = rp_SnapshotString(header, keys[i].Name, keys[i].NameLength) && rp_SnapshotString(header, keys[i].LookupName, keys[i].NameLength)
+			&& rp_SnapshotString(header, keys[i].Value, keys[i].ValueLength);
+
+	return valid;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Ini *rp_LoadSnapshot(const char *iniPath, S_IniConfig *config, S_FileInfo *source)
+{
+	// a missing, stale or damaged snapshot isn't an error, the INI is parsed instead
+	S_Ini *ini = NULL;
+	char *snapshotPath = rp_SnapshotPath(iniPath);
+	ORP_HANDLE hMap = snapshotPath ? rp_MapFile(snapshotPath) : NULL;
+
+	if(hMap)
+	{
+		uint64_t imageSize = 0;
+		const unsigned char *image = rp_GetMappedFileData(hMap, &imageSize);
+
+		if(rp_ValidateSnapshot(image, imageSize, config, source))
+			ini = rp_mallocZ(sizeof(S_Ini));
+
+		if(ini)
+		{
+			rp_InitializeConfig(config, &ini->Config);
+			ini->Snapshot = (const S_SnapshotHeader *)image;
+			ini->hMap = hMap;
+			rp_ArenaInit(&ini->Arena, 0); // only typed values are allocated from it
+		}
+		else
+			rpFreeHandle(hMap);
+	}
+
+	rp_free(snapshotPath);
+	rp_ClearLastError();
+
+	return ini;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Ini *rp_AcquireSharedIni(S_IniConfig *config, S_FileInfo *source)
+{
+	// the caller holds gSharedLock, an INI is only shared with opens that use the same parse options
+	S_Ini *ini = gSharedInis;
+
+	while(ini && (memcmp(&ini->SharedInfo, source, sizeof(S_FileInfo)) != 0 || rp_SnapshotConfig(&ini->Config) != rp_SnapshotConfig(config)))
+		ini = ini->NextShared;
+
+	if(ini)
+		ini->RefCount++;
+
+	return ini;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_MaterializeStrings(S_Ini *ini)
+{
+	// create every string enumeration and typed reads would otherwise copy on demand,
+	// so that lookups never modify a shared INI's symbols
+	ORP_ERR r = ORP_ERR_NO_ERROR;
+
+	for(S_IniSymbol *sectionSym = ini->FirstSection; sectionSym && r == ORP_ERR_NO_ERROR; sectionSym = sectionSym->NextSymbol)
+	{
+		for(S_IniSymbol *keySym = sectionSym->Children; keySym && !sectionSym->Shadowed && r == ORP_ERR_NO_ERROR; keySym = keySym->NextSymbol)
+		{
+			if(keySym->Type == SYM_KeyName && !keySym->Shadowed)
+			{
+				if(!rp_SymbolString(ini, keySym) || (keySym->Children && !rp_SymbolString(ini, keySym->Children)))
+					r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
+			}
+		}
+	}
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_Ini *rp_ShareIni(S_Ini *ini, S_FileInfo *source)
+{
+	// another thread may have opened the same file in the meantime, its INI wins and this one is dropped
+	S_Ini *shared = NULL;
+
+	if(ini->Snapshot || rp_MaterializeStrings(ini) == ORP_ERR_NO_ERROR)
+	{
+		ini->Shared = true;
+		ini->RefCount = 1;
+		ini->SharedInfo = *source;
+
+		rp_SpinLock(&gSharedLock);
+
+		shared = rp_AcquireSharedIni(&ini->Config, source);
+
+		if(!shared)
+		{
+			ini->NextShared = gSharedInis;
+			gSharedInis = ini;
+			shared = ini;
+		}
+
+		rp_SpinUnlock(&gSharedLock);
+	}
+
+	if(shared != ini)
+		rp_DestroyIni(ini);
+
+	return shared;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_CreateIniHandle(S_Ini *ini)
+{
+	ORP_HANDLE hIni = rp_CreateHandle(ini, rp_IniClose);
+
+	if(!hIni && ini->Shared)
+		rp_ReleaseSharedIni(ini);
+	else if(!hIni)
+		rp_DestroyIni(ini);
+
+	return hIni;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -684,46 +2399,168 @@ ORP_HANDLE rp_IniOpen(const char *iniPath, S_IniConfig *config)
 	assert(iniPath != NULL);
 	rp_ClearLastError();
 
-	S_Ini *ini = NULL;
-	enum { ERRLEN = 512 };
-	char errBuf[ERRLEN];
+	S_IniConfig iniConfig;
+	rp_InitializeConfig(config, &iniConfig);
 
-	memset(errBuf, 0, ERRLEN);
-	uint64_t fileSizeFull = rp_GetFileSize(iniPath);
+	// a snapshot is built from every section, loading one is cheaper than parsing lazily anyway
+	// lookups parse lazy sections, which a shared INI can't allow
+	if(iniConfig.Snapshot || iniConfig.Shared)
+		iniConfig.LazySections = false;
 
-	if(rpGetLastError() == ORP_ERR_NO_ERROR)
+	S_IniSource source;
+	S_FileInfo sourceInfo;
+	S_Ini *ini = NULL;
+	bool haveInfo = (iniConfig.Snapshot || iniConfig.Shared) && rp_GetFileInfo(iniPath, &sourceInfo) == ORP_ERR_NO_ERROR;
+	bool snapshot = iniConfig.Snapshot && haveInfo;
+	bool shared = iniConfig.Shared && haveInfo;
+
+	if(shared)
 	{
-		if(fileSizeFull >= 0 && fileSizeFull <= SIZE_MAX)
-		{
-			size_t fileSize = (size_t)fileSizeFull;
-			unsigned char *data = rp_malloc(fileSize);
+		rp_SpinLock(&gSharedLock);
+		ini = rp_AcquireSharedIni(&iniConfig, &sourceInfo);
+		rp_SpinUnlock(&gSharedLock);
+	}
 
-			if(data)
-			{
-				FILE *fp = fopen(iniPath, "rb");
+	if(!ini && snapshot)
+		ini = rp_LoadSnapshot(iniPath, &iniConfig, &sourceInfo);
+	else
+		rp_ClearLastError(); // rp_OpenIniSource reports a missing file
 
-				if(fp)
-				{
-					if(fread(data, 1, fileSize, fp) != fileSize)
-						ini = rp_CreateIni(config, NULL, NULL, ORP_ERR_FILE_IO, "Failed to read from file.");
-					else
-						ini = rp_ParseIni(config, data, fileSize);
+	bool acquired = ini && ini->Shared;
 
-					fclose(fp);
-				}
-				else
-					ini = rp_CreateIni(config, NULL, NULL, ORP_ERR_FILE_NOT_FOUND, rp_Concat(errBuf, ERRLEN, "File: %s", iniPath));
+	if(!ini && rp_OpenIniSource(iniPath, &iniConfig, &source) == ORP_ERR_NO_ERROR)
+	{
+		ini = rp_ParseIni(&iniConfig, source.Data, source.DataLength);
 
-				rp_free(data);
-			}
+		if(ini)
+		{
+			// symbols are views into the file data, it lives as long as the INI
+			ini->Data = source.Buffer;
+			ini->hMap = source.hMap;
+
+			// only save the snapshot if the INI didn't change while it was read
+			S_FileInfo readInfo;
+			if(snapshot && rp_GetFileInfo(iniPath, &readInfo) == ORP_ERR_NO_ERROR && memcmp(&readInfo, &sourceInfo, sizeof(S_FileInfo)) == 0)
+				rp_SaveSnapshot(ini, iniPath, &sourceInfo);
 			else
-				ini = rp_CreateIni(config, NULL, NULL, ORP_ERR_MEM_ALLOC, NULL);
+				rp_ClearLastError();
 		}
 		else
-			ini = rp_CreateIni(config, NULL, NULL, ORP_ERR_FILE_NOT_FOUND, rp_Concat(errBuf, ERRLEN, "File: %s", iniPath));
+			rp_CloseIniSource(&source);
+	}
+
+	if(ini && shared && !acquired)
+		ini = rp_ShareIni(ini, &sourceInfo);
+
+	return ini ? rp_CreateIniHandle(ini) : NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE rp_IniOpenBuffer(const void *data, size_t length, S_IniConfig *config)
+{
+	assert(data != NULL || length == 0);
+	rp_ClearLastError();
+
+	S_IniConfig iniConfig;
+	rp_InitializeConfig(config, &iniConfig);
+
+	// snapshots and sharing are keyed by the file's identity, memory has none
+	iniConfig.MemoryMapped = false;
+	iniConfig.Snapshot = false;
+	iniConfig.Shared = false;
+
+	S_Ini *ini = NULL;
+	unsigned char *copy = NULL;
+
+	if(length > INT64_MAX)
+		rp_SetLastError(ORP_ERR_BAD_RANGE, NULL);
+	else if(!iniConfig.BorrowBuffer && length > 0 && (copy = rp_malloc(length)) != NULL)
+		memcpy(copy, data, length);
+
+	if(rpGetLastError() == ORP_ERR_NO_ERROR)
+		ini = rp_ParseIni(&iniConfig, iniConfig.BorrowBuffer ? data : copy, (int64_t)length);
+
+	if(ini)
+		ini->Data = copy; // symbols are views into the copy, it lives as long as the INI
+	else
+		rp_free(copy);
+
+	return ini ? rp_CreateIniHandle(ini) : NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_StreamSection(S_ParseContext *context, S_Offset *name)
+{
+	S_StreamCallbacks *callbacks = context->Handler.UserPtr;
+	const char *section = (const char *)context->Data + name->Start;
+
+	return callbacks->Section ? callbacks->Section(section, rp_ViewLength(section, (size_t)name->Count), callbacks->UserPtr) : true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_StreamKey(S_ParseContext *context, S_Offset *key, S_Offset *value)
+{
+	S_StreamCallbacks *callbacks = context->Handler.UserPtr;
+	const char *keyName = (const char *)context->Data + key->Start;
+	const char *keyValue = value ? (const char *)context->Data + value->Start : "";
+
+	return callbacks->Key ? callbacks->Key(keyName, rp_ViewLength(keyName, (size_t)key->Count), keyValue, value ? rp_ViewLength(keyValue, (size_t)value->Count) : 0, callbacks->UserPtr) : true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_IniParseStream(const char *iniPath, S_IniConfig *config, STREAM_SECTION_CALLBACK sectionCallback, STREAM_KEY_CALLBACK keyCallback, void *userPtr)
+{
+	assert(iniPath != NULL);
+	rp_ClearLastError();
+
+	S_StreamCallbacks callbacks = { sectionCallback, keyCallback, userPtr };
+
+	S_IniConfig iniConfig;
+	rp_InitializeConfig(config, &iniConfig);
+
+	S_IniSource source;
+	ORP_ERR r = rp_OpenIniSource(iniPath, &iniConfig, &source);
+
+	if(r == ORP_ERR_NO_ERROR)
+	{
+		// same tokenizer as rp_IniOpen, but tokens go straight to the callbacks and no symbols are created
+		S_ParseContext context;
+
+		rp_InitializeContext(&context, &iniConfig, source.Data, 0, source.DataLength);
+		context.Handler.Section = rp_StreamSection;
+		context.Handler.Key = rp_StreamKey;
+		context.Handler.UserPtr = &callbacks;
+
+		rp_Tokenize(&context);
+
+		r = rpGetLastError();
+		rp_ArenaFree(&context.Arena);
+		rp_CloseIniSource(&source);
 	}
 
-	return ini ? rp_CreateHandle(ini, rp_IniClose) : NULL;
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool rp_IniViewEquals(const char *view, size_t length, const char *s, bool caseSensitive)
+{
+	int r = caseSensitive ? strncmp(view, s, length) : STRNICMP(view, s, length);
+	return r == 0 && s[length] == 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -736,9 +2573,9 @@ bool rp_IniHasKey(ORP_HANDLE hIni, const char *section, const char *key)
 	rp_ClearLastError();
 
 	S_Ini *ini = rp_HandleToTarget(hIni);
-	S_IniSymbol *keySym;
+	S_IniValue value;
 
-	return rp_FindKey(ini, section, key, &keySym) == ORP_ERR_NO_ERROR ? true : false;
+	return rp_FindKey(ini, section, key, &value) == ORP_ERR_NO_ERROR ? true : false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -751,9 +2588,9 @@ bool rp_IniHasSection(ORP_HANDLE hIni, const char *section)
 	rp_ClearLastError();
 
 	S_Ini *ini = rp_HandleToTarget(hIni);
-	S_IniSymbol *sectionSym;
+	S_IniSection sectionRef;
 
-	return rp_FindSection(ini, section, &sectionSym) == ORP_ERR_NO_ERROR ? true : false;
+	return rp_FindSection(ini, section, &sectionRef) == ORP_ERR_NO_ERROR ? true : false;
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -768,14 +2605,15 @@ ORP_ERR rp_IniReadKey(ORP_HANDLE hIni, const char *section, const char *key, cha
 	if(length > 0)
 	{
 		S_Ini *ini = rp_HandleToTarget(hIni);
-		S_IniSymbol *keySym;
+		S_IniValue value;
 
-		r = rp_FindKey(ini, section, key, &keySym);
+		r = rp_FindKey(ini, section, key, &value);
 		if(r == ORP_ERR_NO_ERROR)
 		{
-			strncpy(dest, keySym->Value, length);
-			if(length <= strlen(keySym->Value))
-				dest[length - 1] = 0;
+			size_t n = value.Length < length ? value.Length : length - 1;
+
+			memcpy(dest, value.Value, n);
+			dest[n] = 0;
 		}
 	}
 
@@ -792,11 +2630,33 @@ ORP_ERR rp_IniReadKeyLength(ORP_HANDLE hIni, const char *section, const char *ke
 	rp_ClearLastError();
 
 	S_Ini *ini = rp_HandleToTarget(hIni);
-	S_IniSymbol *keySym;
+	S_IniValue value;
 
-	ORP_ERR r = rp_FindKey(ini, section, key, &keySym);
+	ORP_ERR r = rp_FindKey(ini, section, key, &value);
 	if(r == ORP_ERR_NO_ERROR && length != NULL)
-		*length = strlen(keySym->Value);
+		*length = value.Length;
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_IniGetKeyView(ORP_HANDLE hIni, const char *section, const char *key, const char **value, size_t *length)
+{
+	assert(hIni != NULL && section != NULL && key != NULL && value != NULL && length != NULL);
+	rp_ClearLastError();
+
+	S_Ini *ini = rp_HandleToTarget(hIni);
+	S_IniValue keyValue;
+
+	ORP_ERR r = rp_FindKey(ini, section, key, &keyValue);
+	if(r == ORP_ERR_NO_ERROR)
+	{
+		*value = keyValue.Value;
+		*length = keyValue.Length;
+	}
 
 	return r;
 }
@@ -810,23 +2670,70 @@ ORP_ERR rp_IniReadInt(ORP_HANDLE hIni, const char *section, const char *key, int
 	assert(hIni != NULL && section != NULL && key != NULL);
 	rp_ClearLastError();
 
-	S_Ini *ini = rp_HandleToTarget(hIni);
-	S_IniSymbol *keySym;
+	S_IniTypedValue *typed = NULL;
+	ORP_ERR r = rp_FindTypedValue(hIni, section, key, TYPED_INT, &typed);
+
+	if(r == ORP_ERR_NO_ERROR && value != NULL)
+		*value = typed->Int;
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_IniReadBool(ORP_HANDLE hIni, const char *section, const char *key, bool *value)
+{
+	assert(hIni != NULL && section != NULL && key != NULL);
+	rp_ClearLastError();
+
+	S_IniTypedValue *typed = NULL;
+	ORP_ERR r = rp_FindTypedValue(hIni, section, key, TYPED_BOOL, &typed);
 
-	ORP_ERR r = rp_FindKey(ini, section, key, &keySym);
 	if(r == ORP_ERR_NO_ERROR && value != NULL)
+		*value = typed->Bool;
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_IniReadIntList(ORP_HANDLE hIni, const char *section, const char *key, const int **values, size_t *count)
+{
+	assert(hIni != NULL && section != NULL && key != NULL && values != NULL && count != NULL);
+	rp_ClearLastError();
+
+	S_IniTypedValue *typed = NULL;
+	ORP_ERR r = rp_FindTypedValue(hIni, section, key, TYPED_INT_LIST, &typed);
+
+	if(r == ORP_ERR_NO_ERROR)
 	{
-		char *e = NULL;
-		long v = strtol(keySym->Value, &e, 0);
+		*values = typed->Ints;
+		*count = typed->NumInts;
+	}
 
-		if(e - keySym->Value != strlen(keySym->Value))
-			r = rp_SetLastError(ORP_ERR_BAD_ARG, " Not an integer: %s", keySym->Value);
-		else if(errno == ERANGE)
-			r = rp_SetLastError(ORP_ERR_BAD_RANGE, " Value = %s", keySym->Value);
-		else if(v > INT_MAX)
-			r = rp_SetLastError(ORP_ERR_BAD_RANGE, " Value = %s", keySym->Value);
-		else
-			*value = v;
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR rp_IniReadStringList(ORP_HANDLE hIni, const char *section, const char *key, const char *const **values, size_t *count)
+{
+	assert(hIni != NULL && section != NULL && key != NULL && values != NULL && count != NULL);
+	rp_ClearLastError();
+
+	S_IniTypedValue *typed = NULL;
+	ORP_ERR r = rp_FindTypedValue(hIni, section, key, TYPED_STRING_LIST, &typed);
+
+	if(r == ORP_ERR_NO_ERROR)
+	{
+		*values = typed->Strings;
+		*count = typed->NumStrings;
 	}
 
 	return r;
@@ -838,76 +2745,50 @@ ORP_ERR rp_IniReadInt(ORP_HANDLE hIni, const char *section, const char *key, int
 /////////////////////////////////////////////////////////////////////////////////
 ORP_ERR rp_IniEnumerateKeys(ORP_HANDLE hIni, const char *section, ENUM_KEYS_CALLBACK callback, void *userPtr)
 {
-	// this is a bit hacky
-	// problem is, duplicate sections/keys are not removed during parsing
-	// this is not a problem in Ini_Read* functions b/c they alter foward/reverse key traversing and stop on the first match
-	// Enumerate can't stop on the first match and needs a way to filter out duplicates
-	// work-around is to build a list using S_EnumKey that filters out duplicates based on S_IniConfig::DuplicateMode
+	// duplicate keys are marked as shadowed when the key index is built, so enumeration is a single pass
+	// keys are visited in file order when ignoring duplicates and in reverse order when overwriting
 
 	assert(hIni != NULL && section != NULL);
 	rp_ClearLastError();
 
 	S_Ini *ini = rp_HandleToTarget(hIni);
-	S_IniSymbol *sectionSym;
-	ORP_ERR r = rp_FindSection(hIni, section, &sectionSym);
+	S_IniSection sectionRef;
+	ORP_ERR r = rp_FindSection(ini, section, &sectionRef);
 
-	if(r == ORP_ERR_NO_ERROR)
+	if(r == ORP_ERR_NO_ERROR && sectionRef.Entry)
+	{
+		// snapshot keys are stored in enumeration order and without duplicates
+		const char *strings = (const char *)ini->Snapshot + ini->Snapshot->Strings;
+		const S_SnapshotKey *keys = (const S_SnapshotKey *)((const unsigned char *)ini->Snapshot + ini->Snapshot->Keys) + sectionRef.Entry->FirstKey;
+
+		for(uint32_t i = 0; i < sectionRef.Entry->NumKeys && callback(strings + keys[i].Name, strings + keys[i].Value, userPtr); i++)
+			;
+	}
+	else if(r == ORP_ERR_NO_ERROR && (r = rp_LoadLazySection(ini, sectionRef.Symbol)) == ORP_ERR_NO_ERROR)
 	{
-		S_IniSymbol *keySym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? sectionSym->Children : rp_LastSymbol(sectionSym->Children);
-		S_EnumKey enumKeyStart = { 0 };
-		S_EnumKey *ek = &enumKeyStart;
+		bool forward = ini->Config.DuplicateMode == IniDuplicateMode_Ignore;
+		S_IniSymbol *keySym = forward ? sectionRef.Symbol->Children : sectionRef.Symbol->LastChild;
+		bool keepGoing = true;
 
-		while(keySym && r == ORP_ERR_NO_ERROR)
+		while(keySym && r == ORP_ERR_NO_ERROR && keepGoing)
 		{
-			// traverse the list of keys and keep track of non-duplicate keys using S_EnumKey
-			if(keySym->Type == SYM_KeyName)
+			if(keySym->Type == SYM_KeyName && !keySym->Shadowed)
 			{
-				if(!rp_ContainsKey(&enumKeyStart, keySym->Value, !ini->Config.KeysCaseInsensitive)) // No Duplicates
+				if(keySym->Children && keySym->Children->Type == SYM_Key)
 				{
-					if(ek->Key)
-					{
-						ek->NextKey = rp_malloc(sizeof(S_EnumKey));
-						if(!ek->NextKey)
-							r = rp_SetLastError(ORP_ERR_MEM_ALLOC, "");
-						else
-						{
-							ek = ek->NextKey;
-							ek->Key = keySym;
-							ek->NextKey = NULL;
-						}
-					}
+					const char *keyStr = rp_SymbolString(ini, keySym);
+					const char *valueStr = rp_SymbolString(ini, keySym->Children);
+
+					if(keyStr && valueStr)
+						keepGoing = callback(keyStr, valueStr, userPtr);
 					else
-						ek->Key = keySym;
+						r = rp_SetLastError(ORP_ERR_MEM_ALLOC, NULL);
 				}
-			}
-
-			keySym = ini->Config.DuplicateMode == IniDuplicateMode_Ignore ? keySym->NextSymbol : keySym->PrevSymbol;
-		}
-
-		// all keys, with duplicates stripped, can now be referenced from enumKeyStart
-		// walk the list and invoke the user callback function for each
-		ek = &enumKeyStart;
-		bool keepGoing = true;
-
-		if(ek->Key)
-		{
-			while(r == ORP_ERR_NO_ERROR && ek && keepGoing)
-			{
-				if(ek->Key->Children && ek->Key->Children->Type == SYM_Key)
-					keepGoing = callback(ek->Key->Value, ek->Key->Children->Value, userPtr);
 				else
-					r = rp_SetLastError(ORP_ERR_INI_MISSING_KEYVALUE, " Section name = %s, Key name = %s.", section, ek->Key);
-
-				ek = ek->NextKey;
+					r = rp_SetLastError(ORP_ERR_INI_MISSING_KEYVALUE, " Section name = %s, Key name = %.*s.", section, (int)keySym->Length, keySym->Value);
 			}
 
-			ek = enumKeyStart.NextKey;
-			while(ek)
-			{
-				S_EnumKey *tempEk = ek->NextKey;
-				rp_free(ek);
-				ek = tempEk;
-			}
+			keySym = forward ? keySym->NextSymbol : keySym->PrevSymbol;
 		}
 	}
 
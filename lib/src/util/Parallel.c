@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/util/Parallel.h"
+#include "OpenRP1210/platform/Platform.h"
+#include "OpenRP1210/Common.h"
+#include <assert.h>
+
+#define PARALLEL_MAX_THREADS 16
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+typedef struct S_ParallelWork_t
+{
+	PARALLEL_TASK Task;
+	void *UserPtr;
+	unsigned int Count;
+	volatile long NextIndex;
+}S_ParallelWork;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static void rp_ParallelWorker(void *userPtr)
+{
+	// indexes are handed out one at a time so uneven tasks still balance across threads
+	S_ParallelWork *work = userPtr;
+	long index;
+
+	while((index = rp_AtomicIncrement(&work->NextIndex) - 1) < (long)work->Count)
+		work->Task(work->UserPtr, (unsigned int)index);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void rp_ParallelFor(unsigned int count, unsigned int maxThreads, PARALLEL_TASK task, void *userPtr)
+{
+	assert(task != NULL);
+
+	S_ParallelWork work = { task, userPtr, count, 0 };
+	ORP_HANDLE hThreads[PARALLEL_MAX_THREADS];
+	unsigned int numThreads = 0;
+
+	if(maxThreads > PARALLEL_MAX_THREADS)
+		maxThreads = PARALLEL_MAX_THREADS;
+	if(maxThreads > count)
+		maxThreads = count;
+
+	while(numThreads + 1 < maxThreads)
+	{
+		ORP_HANDLE hThread = rp_CreateThread(rp_ParallelWorker, &work);
+		if(!hThread)
+		{
+			rp_ClearLastError(); // not fatal, the remaining work is done by the threads that did start
+			break;
+		}
+
+		hThreads[numThreads++] = hThread;
+	}
+
+	rp_ParallelWorker(&work);
+
+	// freeing a thread handle waits for the thread to finish
+	for(unsigned int i = 0; i < numThreads; i++)
+		rpFreeHandle(hThreads[i]);
+}
@@ -0,0 +1,305 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/util/Scan.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// SSE2 is part of every x64 CPU, AVX2 is selected at runtime when the CPU supports it.
+// Define ORP_SCAN_SCALAR to build only the portable byte-at-a-time version.
+#if !defined(ORP_SCAN_SCALAR) && (defined(__x86_64__) || defined(_M_X64))
+	#define SCAN_SIMD
+	#include <immintrin.h>
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define TARGET_AVX2
+	#else
+		#define TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#define CARRIGE_RETURN 0x0D
+#define LINE_FEED 0x0A
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static inline bool rp_ByteIsPrintable(unsigned char c)
+{
+	return c >= 32 && c <= 126;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_ScalarToCharOrControl(const unsigned char *data, size_t start, size_t length, unsigned char c)
+{
+	while(start < length && data[start] != c && rp_ByteIsPrintable(data[start]))
+		start++;
+
+	return start;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_ScalarToNewLine(const unsigned char *data, size_t start, size_t length)
+{
+	while(start < length && data[start] != CARRIGE_RETURN && data[start] != LINE_FEED)
+		start++;
+
+	return start;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_ScalarToNonSpace(const unsigned char *data, size_t start, size_t length)
+{
+	while(start < length && (data[start] == ' ' || !rp_ByteIsPrintable(data[start])))
+		start++;
+
+	return start;
+}
+
+#ifdef SCAN_SIMD
+
+// The kernels compare bytes as signed 8 bit values, which puts 128-255 below 0.
+// Printable bytes are then exactly those with 32 <= b < 127.
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static inline unsigned int rp_FirstBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return (unsigned int)__builtin_ctz(mask);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_Sse2ToCharOrControl(const unsigned char *data, size_t length, unsigned char c)
+{
+	const __m128i ch = _mm_set1_epi8((char)c), space = _mm_set1_epi8(32), del = _mm_set1_epi8(127);
+	size_t i = 0;
+
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, ch), _mm_cmplt_epi8(v, space)), _mm_cmpeq_epi8(v, del));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(m);
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return rp_ScalarToCharOrControl(data, i, length, c);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_Sse2ToNewLine(const unsigned char *data, size_t length)
+{
+	const __m128i cr = _mm_set1_epi8(CARRIGE_RETURN), lf = _mm_set1_epi8(LINE_FEED);
+	size_t i = 0;
+
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return rp_ScalarToNewLine(data, i, length);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static size_t rp_Sse2ToNonSpace(const unsigned char *data, size_t length)
+{
+	const __m128i space = _mm_set1_epi8(32), del = _mm_set1_epi8(127);
+	size_t i = 0;
+
+	for(; i + 16 <= length; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_andnot_si128(_mm_cmpeq_epi8(v, del), _mm_cmpgt_epi8(v, space)));
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return rp_ScalarToNonSpace(data, i, length);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+TARGET_AVX2 static size_t rp_Avx2ToCharOrControl(const unsigned char *data, size_t length, unsigned char c)
+{
+	const __m256i ch = _mm256_set1_epi8((char)c), space = _mm256_set1_epi8(32), del = _mm256_set1_epi8(127);
+	size_t i = 0;
+
+	for(; i + 32 <= length; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+		__m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, ch), _mm256_cmpgt_epi8(space, v)), _mm256_cmpeq_epi8(v, del));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(m);
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return i + rp_Sse2ToCharOrControl(data + i, length - i, c);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+TARGET_AVX2 static size_t rp_Avx2ToNewLine(const unsigned char *data, size_t length)
+{
+	const __m256i cr = _mm256_set1_epi8(CARRIGE_RETURN), lf = _mm256_set1_epi8(LINE_FEED);
+	size_t i = 0;
+
+	for(; i + 32 <= length; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return i + rp_Sse2ToNewLine(data + i, length - i);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+TARGET_AVX2 static size_t rp_Avx2ToNonSpace(const unsigned char *data, size_t length)
+{
+	const __m256i space = _mm256_set1_epi8(32), del = _mm256_set1_epi8(127);
+	size_t i = 0;
+
+	for(; i + 32 <= length; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(data + i));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(_mm256_cmpeq_epi8(v, del), _mm256_cmpgt_epi8(v, space)));
+
+		if(mask)
+			return i + rp_FirstBit(mask);
+	}
+
+	return i + rp_Sse2ToNonSpace(data + i, length - i);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static bool rp_DetectAvx2(void)
+{
+#if defined(_MSC_VER)
+	// AVX2 needs CPU support (leaf 7 EBX bit 5) and the OS saving YMM state (OSXSAVE + XCR0 bits 1-2)
+	int info[4];
+	bool avx2 = false;
+
+	__cpuid(info, 0);
+	if(info[0] >= 7)
+	{
+		__cpuid(info, 1);
+		if((info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6)
+		{
+			__cpuidex(info, 7, 0);
+			avx2 = (info[1] & (1 << 5)) != 0;
+		}
+	}
+
+	return avx2;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+static bool rp_UseAvx2(void)
+{
+	// 0 = not checked yet, 1 = SSE2, 2 = AVX2
+	// concurrent first calls detect the same value, so the unsynchronized store is harmless
+	static volatile int level = 0;
+
+	if(level == 0)
+		level = rp_DetectAvx2() ? 2 : 1;
+
+	return level == 2;
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t rp_ScanToCharOrControl(const unsigned char *data, size_t length, unsigned char c)
+{
+#ifdef SCAN_SIMD
+	return rp_UseAvx2() ? rp_Avx2ToCharOrControl(data, length, c) : rp_Sse2ToCharOrControl(data, length, c);
+#else
+	return rp_ScalarToCharOrControl(data, 0, length, c);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t rp_ScanToNewLine(const unsigned char *data, size_t length)
+{
+#ifdef SCAN_SIMD
+	return rp_UseAvx2() ? rp_Avx2ToNewLine(data, length) : rp_Sse2ToNewLine(data, length);
+#else
+	return rp_ScalarToNewLine(data, 0, length);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t rp_ScanToNonSpace(const unsigned char *data, size_t length)
+{
+#ifdef SCAN_SIMD
+	return rp_UseAvx2() ? rp_Avx2ToNonSpace(data, length) : rp_Sse2ToNonSpace(data, length);
+#else
+	return rp_ScalarToNonSpace(data, 0, length);
+#endif
+}
@@ -0,0 +1,418 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Micro-benchmark for lib/src/util/Ini.c. Generates an RP1210 style INI and times
+// opening, key lookups, key enumeration and closing separately.
+//
+// Built by "make IniBench", it's linked against the library objects with malloc
+// wrapped so allocations made by the parser can be counted.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define NAME_LENGTH 64
+
+typedef struct S_BenchArgs_t
+{
+	unsigned int Sections;
+	unsigned int Keys;         // per section
+	unsigned int ValueLength;
+	unsigned int DuplicateRate; // percent of keys written a second time with another value
+	unsigned int CaseRate;      // percent of names written with their case scrambled
+	unsigned int Iterations;
+	unsigned int Lookups;
+	bool Lazy;
+	bool Mapped;
+	bool CaseSensitive;
+	const char *File;
+}S_BenchArgs;
+
+typedef struct S_BenchTimer_t
+{
+	uint64_t Ns;
+	uint64_t Ops;
+	uint64_t Allocs;
+}S_BenchTimer;
+
+static const char *gKeyNames[] =
+{
+	"DeviceID", "DeviceDescription", "DeviceName", "DeviceParams", "MultiCANChannels", "MultiJ1939Channels",
+	"MultiISO15765Channels", "ProtocolString", "ProtocolDescription", "ProtocolSpeed", "ProtocolParams", "Devices"
+};
+
+static uint64_t gAllocs; // atomic, large files are tokenized on several threads
+static uint64_t gRandom = 0x9E3779B97F4A7C15ull;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *__wrap_malloc(size_t size)
+{
+	__atomic_fetch_add(&gAllocs, 1, __ATOMIC_RELAXED);
+	return __real_malloc(size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+/// Compilers turn malloc followed by memset into calloc.
+///
+/////////////////////////////////////////////////////////////////////////////////
+void *__wrap_calloc(size_t count, size_t size)
+{
+	__atomic_fetch_add(&gAllocs, 1, __ATOMIC_RELAXED);
+	return __real_calloc(count, size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint64_t Allocs(void)
+{
+	return __atomic_load_n(&gAllocs, __ATOMIC_RELAXED);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t Random(void)
+{
+	// xorshift64*, every run with the same arguments generates the same file
+	gRandom ^= gRandom >> 12;
+	gRandom ^= gRandom << 25;
+	gRandom ^= gRandom >> 27;
+
+	return (uint32_t)((gRandom * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint64_t Now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void SectionName(unsigned int index, char *buf)
+{
+	if(index == 0)
+		snprintf(buf, NAME_LENGTH, "VendorInformation");
+	else
+		snprintf(buf, NAME_LENGTH, index % 2 ? "DeviceInformation%u" : "ProtocolInformation%u", (index + 1) / 2);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void KeyName(unsigned int index, char *buf)
+{
+	unsigned int numNames = sizeof(gKeyNames) / sizeof(gKeyNames[0]);
+
+	if(index < numNames)
+		snprintf(buf, NAME_LENGTH, "%s", gKeyNames[index]);
+	else
+		snprintf(buf, NAME_LENGTH, "%s%u", gKeyNames[index % numNames], index / numNames);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void WriteName(FILE *f, const char *name, unsigned int caseRate)
+{
+	bool scramble = Random() % 100 < caseRate;
+
+	for(const char *c = name; *c; c++)
+		fputc(scramble && Random() % 2 ? (isupper((unsigned char)*c) ? tolower((unsigned char)*c) : toupper((unsigned char)*c)) : *c, f);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void WriteValue(FILE *f, unsigned int length)
+{
+	for(unsigned int i = 0; i < length; i++)
+		fputc(i % 8 == 7 ? ',' : 'A' + (int)(Random() % 26), f);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool GenerateIni(const S_BenchArgs *args, uint64_t *fileSize, uint64_t *numSymbols)
+{
+	char name[NAME_LENGTH];
+	FILE *f = fopen(args->File, "wb");
+
+	if(!f)
+		return false;
+
+	fprintf(f, "; generated by IniBench\r\n");
+	*numSymbols = args->Sections;
+
+	for(unsigned int s = 0; s < args->Sections; s++)
+	{
+		SectionName(s, name);
+		fputc('[', f);
+		WriteName(f, name, args->CaseRate);
+		fprintf(f, "]\r\n");
+
+		for(unsigned int k = 0; k < args->Keys; k++)
+		{
+			unsigned int writes = Random() % 100 < args->DuplicateRate ? 2 : 1;
+			KeyName(k, name);
+
+			for(unsigned int w = 0; w < writes; w++)
+			{
+				WriteName(f, name, args->CaseRate);
+				fputc('=', f);
+				WriteValue(f, args->ValueLength);
+				fprintf(f, "\r\n");
+			}
+
+			*numSymbols += 2 * writes; // name and value
+		}
+
+		fprintf(f, "\r\n");
+	}
+
+	*fileSize = (uint64_t)ftell(f);
+	fclose(f);
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CountKey(const char *key, const char *value, void *userPtr)
+{
+	(*(uint64_t *)userPtr)++;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void PrintTimer(const char *phase, const S_BenchTimer *timer, const char *unit)
+{
+	double nsPerOp = timer->Ops ? (double)timer->Ns / (double)timer->Ops : 0.0;
+	printf("%-10s %12llu %14.1f ns/%-8s", phase, (unsigned long long)timer->Ops, nsPerOp, unit);
+
+	if(timer->Ops)
+		printf(" %10.1f allocs/%s", (double)timer->Allocs / (double)timer->Ops, unit);
+
+	printf("\n");
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool ParseArgs(int argc, char **argv, S_BenchArgs *args)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[++i] : NULL;
+		unsigned int *target = NULL;
+
+		if(!value)
+		{
+			printf("Missing value for command line argument: %s\n", arg);
+			return false;
+		}
+
+		if(strcmp(arg, "-sections") == 0)
+			target = &args->Sections;
+		else if(strcmp(arg, "-keys") == 0)
+			target = &args->Keys;
+		else if(strcmp(arg, "-valuelen") == 0)
+			target = &args->ValueLength;
+		else if(strcmp(arg, "-dup") == 0)
+			target = &args->DuplicateRate;
+		else if(strcmp(arg, "-case") == 0)
+			target = &args->CaseRate;
+		else if(strcmp(arg, "-iter") == 0)
+			target = &args->Iterations;
+		else if(strcmp(arg, "-lookups") == 0)
+			target = &args->Lookups;
+		else if(strcmp(arg, "-lazy") == 0)
+			args->Lazy = atoi(value) != 0;
+		else if(strcmp(arg, "-mapped") == 0)
+			args->Mapped = atoi(value) != 0;
+		else if(strcmp(arg, "-casesensitive") == 0)
+			args->CaseSensitive = atoi(value) != 0;
+		else if(strcmp(arg, "-file") == 0)
+			args->File = value;
+		else
+		{
+			printf("Unknown command line argument: %s\n", arg);
+			return false;
+		}
+
+		if(target)
+			*target = (unsigned int)strtoul(value, NULL, 10);
+	}
+
+	if(args->Sections == 0 || args->Iterations == 0)
+	{
+		printf("-sections and -iter must be at least 1.\n");
+		return false;
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+	S_BenchArgs args = { 200, 12, 16, 0, 0, 20, 1000000, false, false, false, "IniBench.ini" };
+
+	if(!ParseArgs(argc, argv, &args))
+	{
+		printf("Usage: IniBench [-sections n] [-keys n] [-valuelen n] [-dup percent] [-case percent]\n"
+			"                [-iter n] [-lookups n] [-lazy 0|1] [-mapped 0|1] [-casesensitive 0|1] [-file path]\n");
+		return 1;
+	}
+
+	uint64_t fileSize = 0, numSymbols = 0;
+	if(!GenerateIni(&args, &fileSize, &numSymbols))
+	{
+		printf("Can't write %s\n", args.File);
+		return 1;
+	}
+
+	S_IniConfig config = rp_CreateDefaultConfig();
+	config.LazySections = args.Lazy;
+	config.MemoryMapped = args.Mapped;
+	config.KeysCaseInsensitive = !args.CaseSensitive; // lookups use the canonical names, case sensitive ones miss keys scrambled by -case
+
+	printf("%u sections, %u keys/section, %u byte values, %u%% duplicates, %u%% case mixed, %llu bytes, %llu symbols%s%s%s\n\n",
+		args.Sections, args.Keys, args.ValueLength, args.DuplicateRate, args.CaseRate, (unsigned long long)fileSize, (unsigned long long)numSymbols,
+		args.Lazy ? ", lazy" : "", args.Mapped ? ", mapped" : "", args.CaseSensitive ? ", case sensitive" : ", case insensitive");
+
+	S_BenchTimer open = { 0 }, close = { 0 }, lookup = { 0 }, enumerate = { 0 };
+	ORP_HANDLE hIni = NULL;
+
+	for(unsigned int i = 0; i < args.Iterations; i++)
+	{
+		uint64_t allocs = Allocs();
+		uint64_t start = Now();
+		hIni = rp_IniOpen(args.File, &config);
+		open.Ns += Now() - start;
+		open.Allocs += Allocs() - allocs;
+		open.Ops++;
+
+		if(!hIni)
+		{
+			printf("rp_IniOpen failed: %s\n", rpGetLastErrorDesc());
+			remove(args.File);
+			return 1;
+		}
+
+		// the last INI is kept open for the lookups below
+		if(i + 1 < args.Iterations)
+		{
+			allocs = Allocs();
+			start = Now();
+			rpFreeHandle(hIni);
+			close.Ns += Now() - start;
+			close.Allocs += Allocs() - allocs;
+			close.Ops++;
+		}
+	}
+
+	// names are formatted up front so only the lookups themselves are timed
+	unsigned int numKeyNames = args.Keys ? args.Keys : 1;
+	char (*sections)[NAME_LENGTH] = malloc(args.Sections * sizeof(*sections));
+	char (*keys)[NAME_LENGTH] = malloc(numKeyNames * sizeof(*keys));
+
+	if(!sections || !keys)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	for(unsigned int s = 0; s < args.Sections; s++)
+		SectionName(s, sections[s]);
+	for(unsigned int k = 0; k < numKeyNames; k++)
+		KeyName(k, keys[k]);
+
+	// lookups visit sections and keys in random order so the hash tables aren't walked sequentially
+	uint64_t allocs = Allocs();
+	uint64_t start = Now();
+
+	for(unsigned int i = 0; i < args.Lookups; i++)
+	{
+		const char *value;
+		size_t length;
+
+		rp_IniGetKeyView(hIni, sections[Random() % args.Sections], keys[Random() % numKeyNames], &value, &length);
+	}
+
+	lookup.Ns = Now() - start;
+	lookup.Allocs = Allocs() - allocs;
+	lookup.Ops = args.Lookups;
+
+	uint64_t numKeys = 0;
+	allocs = Allocs();
+	start = Now();
+
+	for(unsigned int s = 0; s < args.Sections; s++)
+		rp_IniEnumerateKeys(hIni, sections[s], CountKey, &numKeys);
+
+	enumerate.Ns = Now() - start;
+	enumerate.Allocs = Allocs() - allocs;
+	enumerate.Ops = numKeys;
+
+	allocs = Allocs();
+	start = Now();
+	rpFreeHandle(hIni);
+	close.Ns += Now() - start;
+	close.Allocs += Allocs() - allocs;
+	close.Ops++;
+
+	PrintTimer("open", &open, "file");
+	PrintTimer("lookup", &lookup, "key");
+	PrintTimer("enumerate", &enumerate, "key");
+	PrintTimer("close", &close, "file");
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("\npeak RSS %ld KB\n", usage.ru_maxrss);
+
+	free(sections);
+	free(keys);
+	remove(args.File);
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Regression test for discovery of vendor INIs whose lists name devices and
+// protocols that don't exist or aren't numbers.
+//
+// Built and run by "make test", it's linked against the library objects with
+// rp_GetSpecialDir wrapped so the RP1210 home directory is a scratch directory.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/platform/Platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define HOME_LENGTH 64
+#define PATH_LENGTH 256
+
+static char gHome[HOME_LENGTH];
+static unsigned int gFailures;
+
+// Devices and Protocols name sections that don't exist, the J1939 device list has one valid ID
+// among items that aren't numbers, are out of range or are too long to be one. Device 3's ID isn't a number
+static const char gVendorIni[] =
+	"[VendorInformation]\n"
+	"Name=Vendor B\n"
+	"Devices=1, 2,3,7\n"
+	"Protocols=1,5\n"
+	"\n"
+	"[DeviceInformation1]\n"
+	"DeviceID=1\n"
+	"DeviceDescription=Adapter One USB\n"
+	"DeviceName=A1\n"
+	"\n"
+	"[DeviceInformation2]\n"
+	"DeviceID=2\n"
+	"DeviceDescription=Adapter Two USB\n"
+	"DeviceName=A2\n"
+	"\n"
+	"[DeviceInformation3]\n"
+	"DeviceID=0x\n"
+	"DeviceDescription=Adapter Three USB\n"
+	"DeviceName=A3\n"
+	"\n"
+	"[ProtocolInformation1]\n"
+	"ProtocolString=J1939\n"
+	"ProtocolDescription=SAE J1939\n"
+	"Devices=1x,abc, 0x2 ,99999999999999999999,1                                   0\n";
+
+static const char gRP1210Ini[] =
+	"[RP1210Support]\n"
+	"APIImplementations=VENDB\n";
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int __wrap_rp_GetSpecialDir(E_SpecialDir directory, char *buf, unsigned int len)
+{
+	unsigned int dirLen = (unsigned int)strlen(gHome) + 1;
+
+	if(buf && len >= dirLen)
+		memcpy(buf, gHome, dirLen);
+
+	return dirLen;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool WriteFile(const char *name, const char *text)
+{
+	char path[PATH_LENGTH];
+	snprintf(path, PATH_LENGTH, "%s/rp1210/%s", gHome, name);
+
+	FILE *f = fopen(path, "wb");
+	bool written = f && fputs(text, f) >= 0;
+
+	if(f && fclose(f) != 0)
+		written = false;
+
+	return written;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void RemoveFile(const char *name)
+{
+	char path[PATH_LENGTH];
+	snprintf(path, PATH_LENGTH, "%s/rp1210/%s", gHome, name);
+
+	remove(path);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool FileExists(const char *name)
+{
+	char path[PATH_LENGTH];
+	struct stat st;
+	snprintf(path, PATH_LENGTH, "%s/rp1210/%s", gHome, name);
+
+	return stat(path, &st) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void CheckImpl(ORP_HANDLE hImpls, const char *mode)
+{
+	char what[128];
+	ORP_HANDLE hImpl = rpGetApiImplByName(hImpls, "VENDB");
+
+	snprintf(what, sizeof(what), "%s: implementation loads without an error", mode);
+	Check(hImpl != NULL && rpGetLastError() == ORP_ERR_NO_ERROR, what);
+
+	if(!hImpl)
+		return;
+
+	snprintf(what, sizeof(what), "%s: missing device and protocol sections are skipped", mode);
+	Check(rpGetNumDevices(hImpl) == 3 && rpGetNumProtocols(hImpl) == 1, what);
+
+	S_RP1210DeviceInformation *devices[4];
+	unsigned int numDevices = sizeof(devices) / sizeof(devices[0]);
+	ORP_ERR r = rpGetDevicesByProtocol(hImpl, "J1939", devices, &numDevices);
+
+	snprintf(what, sizeof(what), "%s: only whole device IDs are read from a list", mode);
+	Check(r == ORP_ERR_NO_ERROR && numDevices == 1 && rpGetDeviceId(devices[0]) == 2, what);
+
+	S_RP1210DeviceInformation *badDevice = rpGetDeviceInfoByName(hImpl, "A3", 0);
+
+	snprintf(what, sizeof(what), "%s: a DeviceID that isn't a number is rejected", mode);
+	Check(badDevice && rpGetDeviceId(badDevice) == ORP_ERR_BAD_ARG && rpGetDeviceInfoById(hImpl, 0) == NULL, what);
+
+	rpFreeHandle(hImpl);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	char rp1210Dir[PATH_LENGTH];
+	snprintf(gHome, HOME_LENGTH, "/tmp/DiscoveryTest.XXXXXX");
+
+	if(!mkdtemp(gHome))
+	{
+		printf("Can't create a scratch directory\n");
+		return 1;
+	}
+
+	snprintf(rp1210Dir, PATH_LENGTH, "%s/rp1210", gHome);
+
+	if(mkdir(rp1210Dir, 0700) != 0 || !WriteFile("rp121032.ini", gRP1210Ini) || !WriteFile("VENDB.ini", gVendorIni))
+	{
+		printf("Can't write the test INI files to %s\n", rp1210Dir);
+		return 1;
+	}
+
+	ORP_HANDLE hImpls = rpGetApiImpls();
+
+	Check(hImpls != NULL && rpGetLastError() == ORP_ERR_NO_ERROR, "full: discovery has no error");
+	Check(FileExists("openrp1210.cache"), "full: discovery cache is saved");
+
+	if(hImpls)
+	{
+		Check(rpGetNumApiImplLoadErrors(hImpls) == 0, "full: no load errors");
+		CheckImpl(hImpls, "full");
+		rpFreeHandle(hImpls);
+	}
+
+	hImpls = rpGetApiImplsLazy();
+	Check(hImpls != NULL && rpGetLastError() == ORP_ERR_NO_ERROR, "lazy: discovery has no error");
+
+	if(hImpls)
+	{
+		CheckImpl(hImpls, "lazy");
+		rpFreeHandle(hImpls);
+	}
+
+	RemoveFile("openrp1210.cache");
+	RemoveFile("VENDB.ini");
+	RemoveFile("rp121032.ini");
+	rmdir(rp1210Dir);
+	rmdir(gHome);
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
@@ -0,0 +1,484 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Equivalence test for the section and key hash indexes of lib/src/util/Ini.c.
+// Generated INIs repeat section and key names in mixed case, and every lookup and
+// enumeration is compared with a linear search of the file's entries that picks
+// the first or last duplicate the way S_IniConfig::DuplicateMode describes.
+//
+// Built and run by "make test", each INI is opened from a buffer, lazily, from a
+// snapshot and shared, with both duplicate modes and with and without case.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#define NUM_INIS 40
+#define MAX_SECTIONS 48
+#define MAX_KEYS 1024
+#define NUM_SECTION_NAMES 8
+#define NUM_KEY_NAMES 10
+#define NAME_LENGTH 192
+#define VALUE_LENGTH 16
+#define PATH_LENGTH 64
+#define TEXT_LENGTH (256 * 1024)
+#define MAX_REPORTS 5
+
+typedef enum E_OpenMode_t
+{
+	OpenMode_Buffer,
+	OpenMode_Lazy,
+	OpenMode_Snapshot,
+	OpenMode_Shared,
+	OpenMode_Count
+}E_OpenMode;
+
+typedef struct S_RefKey_t
+{
+	char Name[NAME_LENGTH];
+	char Value[VALUE_LENGTH];
+}S_RefKey;
+
+typedef struct S_RefSection_t
+{
+	char Name[NAME_LENGTH];
+	unsigned int FirstKey;
+	unsigned int NumKeys;
+}S_RefSection;
+
+// the INI as written, in file order and with every duplicate
+typedef struct S_RefIni_t
+{
+	S_RefSection Sections[MAX_SECTIONS];
+	unsigned int NumSections;
+	S_RefKey Keys[MAX_KEYS];
+	unsigned int NumKeys;
+	char Text[TEXT_LENGTH];
+	size_t TextLength;
+}S_RefIni;
+
+typedef struct S_EnumText_t
+{
+	char Text[TEXT_LENGTH];
+	size_t Length;
+}S_EnumText;
+
+static const char *gModeNames[] = { "buffer", "lazy", "snapshot", "shared" };
+
+static unsigned int gFailures;
+static unsigned int gReports;
+static uint64_t gRandom = 0x9E3779B97F4A7C15ull;
+static char gPath[PATH_LENGTH];
+static char gSnapshotPath[PATH_LENGTH + 8];
+static S_RefIni gIni;
+static S_EnumText gExpected, gActual;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t Random(void)
+{
+	// xorshift64*, every run tests the same INIs
+	gRandom ^= gRandom >> 12;
+	gRandom ^= gRandom << 25;
+	gRandom ^= gRandom >> 27;
+
+	return (uint32_t)((gRandom * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void MakeName(char *buf, const char *prefix, unsigned int index, unsigned int numNames)
+{
+	// the last name is longer than the parser's buffer for case folded names
+	if(index + 1 < numNames)
+		snprintf(buf, NAME_LENGTH, "%s%u", prefix, index);
+	else
+		snprintf(buf, NAME_LENGTH, "%s%u%0160u", prefix, index, 0u);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void ScrambleCase(char *name)
+{
+	for(char *c = name; *c; c++)
+		*c = Random() % 2 ? (char)toupper((unsigned char)*c) : (char)tolower((unsigned char)*c);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Write(const char *text)
+{
+	size_t length = strlen(text);
+
+	if(gIni.TextLength + length < TEXT_LENGTH)
+	{
+		memcpy(gIni.Text + gIni.TextLength, text, length);
+		gIni.TextLength += length;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void GenerateIni(void)
+{
+	// few distinct names, so most of them repeat, a quarter of them in another case
+	char line[NAME_LENGTH + VALUE_LENGTH + 4];
+	unsigned int numValues = 0;
+
+	gIni.NumSections = 1 + Random() % MAX_SECTIONS;
+	gIni.NumKeys = 0;
+	gIni.TextLength = 0;
+
+	for(unsigned int s = 0; s < gIni.NumSections; s++)
+	{
+		S_RefSection *section = &gIni.Sections[s];
+		MakeName(section->Name, "Section", Random() % NUM_SECTION_NAMES, NUM_SECTION_NAMES);
+		if(Random() % 4 == 0)
+			ScrambleCase(section->Name);
+
+		section->FirstKey = gIni.NumKeys;
+		section->NumKeys = Random() % (MAX_KEYS / MAX_SECTIONS);
+
+		snprintf(line, sizeof(line), "[%s]\n", section->Name);
+		Write(line);
+
+		for(unsigned int k = 0; k < section->NumKeys; k++)
+		{
+			S_RefKey *key = &gIni.Keys[gIni.NumKeys++];
+			MakeName(key->Name, "Key", Random() % NUM_KEY_NAMES, NUM_KEY_NAMES);
+			if(Random() % 4 == 0)
+				ScrambleCase(key->Name);
+
+			snprintf(key->Value, VALUE_LENGTH, "v%u", numValues++);
+			snprintf(line, sizeof(line), "%s=%s\n", key->Name, key->Value);
+			Write(line);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool NamesEqual(const char *a, const char *b, bool caseSensitive)
+{
+	return caseSensitive ? strcmp(a, b) == 0 : strcasecmp(a, b) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_RefSection *RefFindSection(const char *name, S_IniConfig *config)
+{
+	// the first duplicate wins when ignoring duplicates, the last one when overwriting
+	S_RefSection *found = NULL;
+
+	for(unsigned int s = 0; s < gIni.NumSections; s++)
+	{
+		if(NamesEqual(gIni.Sections[s].Name, name, !config->KeysCaseInsensitive) && (!found || config->DuplicateMode == IniDuplicateMode_Overwrite))
+			found = &gIni.Sections[s];
+	}
+
+	return found;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_RefKey *RefFindKey(const char *sectionName, const char *name, S_IniConfig *config)
+{
+	S_RefSection *section = RefFindSection(sectionName, config);
+	S_RefKey *found = NULL;
+
+	for(unsigned int k = 0; section && k < section->NumKeys; k++)
+	{
+		S_RefKey *key = &gIni.Keys[section->FirstKey + k];
+
+		if(NamesEqual(key->Name, name, !config->KeysCaseInsensitive) && (!found || config->DuplicateMode == IniDuplicateMode_Overwrite))
+			found = key;
+	}
+
+	return found;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void AppendKey(S_EnumText *text, const char *key, const char *value)
+{
+	int length = snprintf(text->Text + text->Length, TEXT_LENGTH - text->Length, "%s=%s\n", key, value);
+
+	if(length > 0 && text->Length + (size_t)length < TEXT_LENGTH)
+		text->Length += (size_t)length;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void RefEnumerateKeys(const char *sectionName, S_IniConfig *config, S_EnumText *text)
+{
+	// keys in file order when ignoring duplicates and in reverse when overwriting, so the
+	// first key of each name along the way is the one lookups find
+	S_RefSection *section = RefFindSection(sectionName, config);
+	bool forward = config->DuplicateMode == IniDuplicateMode_Ignore;
+
+	text->Length = 0;
+	text->Text[0] = 0;
+
+	for(unsigned int i = 0; section && i < section->NumKeys; i++)
+	{
+		unsigned int k = section->FirstKey + (forward ? i : section->NumKeys - 1 - i);
+		bool shadowed = false;
+
+		for(unsigned int j = 0; j < i && !shadowed; j++)
+		{
+			unsigned int other = section->FirstKey + (forward ? j : section->NumKeys - 1 - j);
+			shadowed = NamesEqual(gIni.Keys[k].Name, gIni.Keys[other].Name, !config->KeysCaseInsensitive);
+		}
+
+		if(!shadowed)
+			AppendKey(text, gIni.Keys[k].Name, gIni.Keys[k].Value);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool EnumKey(const char *key, const char *value, void *userPtr)
+{
+	AppendKey(userPtr, key, value);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool Report(const char *mode, const char *section, const char *key, const char *what)
+{
+	if(gReports++ < MAX_REPORTS)
+		printf("%s: [%s] %s: %s\n", mode, section, key ? key : "", what);
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckLookups(ORP_HANDLE hIni, S_IniConfig *config, const char *mode)
+{
+	// every name as generated, in upper and in lower case, and one that's never generated
+	char section[NAME_LENGTH], key[NAME_LENGTH];
+	bool same = true;
+
+	for(unsigned int s = 0; s <= NUM_SECTION_NAMES * 3; s++)
+	{
+		if(s == NUM_SECTION_NAMES * 3)
+			snprintf(section, NAME_LENGTH, "Missing");
+		else
+		{
+			MakeName(section, "Section", s / 3, NUM_SECTION_NAMES);
+			for(char *c = section; *c && s % 3; c++)
+				*c = (char)(s % 3 == 1 ? toupper((unsigned char)*c) : tolower((unsigned char)*c));
+		}
+
+		bool hasSection = RefFindSection(section, config) != NULL;
+		if(rp_IniHasSection(hIni, section) != hasSection)
+			same = Report(mode, section, NULL, "rp_IniHasSection differs");
+
+		RefEnumerateKeys(section, config, &gExpected);
+		gActual.Length = 0;
+		gActual.Text[0] = 0;
+
+		ORP_ERR r = rp_IniEnumerateKeys(hIni, section, EnumKey, &gActual);
+		if(r != (hasSection ? ORP_ERR_NO_ERROR : ORP_ERR_INI_SECTION_NOT_FOUND) || gActual.Length != gExpected.Length ||
+			memcmp(gActual.Text, gExpected.Text, gExpected.Length) != 0)
+			same = Report(mode, section, NULL, "rp_IniEnumerateKeys differs");
+
+		for(unsigned int k = 0; k <= NUM_KEY_NAMES * 3; k++)
+		{
+			if(k == NUM_KEY_NAMES * 3)
+				snprintf(key, NAME_LENGTH, "Missing");
+			else
+			{
+				MakeName(key, "Key", k / 3, NUM_KEY_NAMES);
+				for(char *c = key; *c && k % 3; c++)
+					*c = (char)(k % 3 == 1 ? toupper((unsigned char)*c) : tolower((unsigned char)*c));
+			}
+
+			S_RefKey *expected = RefFindKey(section, key, config);
+			const char *value = NULL;
+			size_t length = 0;
+
+			r = rp_IniGetKeyView(hIni, section, key, &value, &length);
+
+			if(expected ? r != ORP_ERR_NO_ERROR || length != strlen(expected->Value) || memcmp(value, expected->Value, length) != 0 : r == ORP_ERR_NO_ERROR)
+				same = Report(mode, section, key, "rp_IniGetKeyView differs");
+		}
+	}
+
+	return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE OpenIni(E_OpenMode mode, S_IniConfig *config)
+{
+	ORP_HANDLE hIni = NULL;
+
+	if(mode == OpenMode_Buffer || mode == OpenMode_Lazy)
+	{
+		config->LazySections = mode == OpenMode_Lazy;
+		hIni = rp_IniOpenBuffer(gIni.Text, gIni.TextLength, config);
+	}
+	else if(mode == OpenMode_Snapshot)
+	{
+		// the first open parses and saves the snapshot, the second one loads it
+		config->Snapshot = true;
+		remove(gSnapshotPath);
+
+		hIni = rp_IniOpen(gPath, config);
+		if(hIni)
+			rpFreeHandle(hIni);
+
+		hIni = access(gSnapshotPath, F_OK) == 0 ? rp_IniOpen(gPath, config) : NULL;
+	}
+	else
+	{
+		config->Shared = true;
+		hIni = rp_IniOpen(gPath, config);
+	}
+
+	return hIni;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool WriteIni(void)
+{
+	FILE *f = fopen(gPath, "wb");
+	bool written = f && fwrite(gIni.Text, 1, gIni.TextLength, f) == gIni.TextLength;
+
+	if(f && fclose(f) != 0)
+		written = false;
+
+	return written;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	bool same[OpenMode_Count][2][2];
+	char what[128];
+
+	snprintf(gPath, PATH_LENGTH, "/tmp/IniIndexTest.XXXXXX");
+
+	int fd = mkstemp(gPath);
+	if(fd < 0)
+	{
+		printf("Can't create a scratch file\n");
+		return 1;
+	}
+
+	close(fd);
+	snprintf(gSnapshotPath, sizeof(gSnapshotPath), "%s.snap", gPath);
+	memset(same, true, sizeof(same));
+
+	for(unsigned int n = 0; n < NUM_INIS; n++)
+	{
+		GenerateIni();
+
+		if(!WriteIni())
+		{
+			printf("Can't write %s\n", gPath);
+			return 1;
+		}
+
+		for(unsigned int mode = 0; mode < OpenMode_Count; mode++)
+		{
+			for(unsigned int dup = 0; dup < 2; dup++)
+			{
+				for(unsigned int sensitive = 0; sensitive < 2; sensitive++)
+				{
+					S_IniConfig config = rp_CreateDefaultConfig();
+					config.DuplicateMode = dup ? IniDuplicateMode_Overwrite : IniDuplicateMode_Ignore;
+					config.KeysCaseInsensitive = !sensitive;
+
+					ORP_HANDLE hIni = OpenIni((E_OpenMode)mode, &config);
+
+					if(!hIni)
+						same[mode][dup][sensitive] = Report(gModeNames[mode], "", NULL, "can't open the INI");
+					else
+					{
+						if(!CheckLookups(hIni, &config, gModeNames[mode]))
+							same[mode][dup][sensitive] = false;
+
+						rpFreeHandle(hIni);
+					}
+				}
+			}
+		}
+	}
+
+	for(unsigned int mode = 0; mode < OpenMode_Count; mode++)
+	{
+		for(unsigned int dup = 0; dup < 2; dup++)
+		{
+			for(unsigned int sensitive = 0; sensitive < 2; sensitive++)
+			{
+				snprintf(what, sizeof(what), "%s, %s duplicates, case %s: lookups and enumeration match a linear search", gModeNames[mode],
+					dup ? "overwrite" : "ignore", sensitive ? "sensitive" : "insensitive");
+				Check(same[mode][dup][sensitive], what);
+			}
+		}
+	}
+
+	remove(gSnapshotPath);
+	remove(gPath);
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
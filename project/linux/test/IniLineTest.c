@@ -0,0 +1,252 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Regression test for the section-parallel parse of large INIs. Errors placed in
+// the first and last lines, in the middle and on the section headers the file is
+// split at must be reported with the line number counted from the start of the
+// file, the same as when the file is parsed in one piece.
+//
+// Built and run by "make test", it's linked with rp_GetProcessorCount wrapped so
+// the file is split the same way on any machine.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define NUM_LINES 80000           // about 3 MB, the parser splits files of 1 MB and more
+#define KEYS_PER_SECTION 10
+#define NUM_CHUNKS 8
+#define LINE_LENGTH 64
+#define DESC_LENGTH 256
+
+typedef struct S_KeySum_t
+{
+	uint64_t NumKeys;
+	uint32_t Hash;
+}S_KeySum;
+
+static unsigned int gFailures;
+static unsigned int gProcessors = 1;
+static unsigned int gProcessorCalls;
+static char *gText;
+static size_t gTextLength;
+static size_t gLineStart[NUM_LINES];
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int __wrap_rp_GetProcessorCount(void)
+{
+	gProcessorCalls++;
+	return gProcessors;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool IsSectionLine(unsigned int line)
+{
+	return line % (KEYS_PER_SECTION + 1) == 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void GenerateIni(const char *newLine, const unsigned int *badLines, unsigned int numBadLines)
+{
+	// bad key lines have no '=', bad section headers no ']', both keep their length so the file is split at the same headers
+	char line[LINE_LENGTH];
+	gTextLength = 0;
+
+	for(unsigned int i = 0; i < NUM_LINES; i++)
+	{
+		bool bad = false;
+		for(unsigned int b = 0; b < numBadLines; b++)
+			bad = bad || badLines[b] == i;
+
+		if(IsSectionLine(i))
+			snprintf(line, LINE_LENGTH, bad ? "[Section%u " : "[Section%u]", i);
+		else
+			snprintf(line, LINE_LENGTH, bad ? "Key%u Value of line %u" : "Key%u=Value of line %u", i % (KEYS_PER_SECTION + 1), i);
+
+		gLineStart[i] = gTextLength;
+		gTextLength += (size_t)sprintf(gText + gTextLength, "%s%s", line, newLine);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned int SectionLineAfter(size_t offset)
+{
+	// the file is split in front of the first section header after an even share of its bytes
+	unsigned int line = 0;
+
+	while(line + 1 < NUM_LINES && (gLineStart[line] <= offset || !IsSectionLine(line)))
+		line++;
+
+	return line;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool SumKey(const char *key, const char *value, void *userPtr)
+{
+	S_KeySum *sum = userPtr;
+
+	for(const char *c = key; *c; c++)
+		sum->Hash = (sum->Hash ^ (unsigned char)*c) * 16777619u;
+	for(const char *c = value; *c; c++)
+		sum->Hash = (sum->Hash ^ (unsigned char)*c) * 16777619u;
+
+	sum->NumKeys++;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR Parse(unsigned int processors, char *desc, S_KeySum *sum)
+{
+	// returns the parse error and its description, or the keys of every section
+	S_IniConfig config = rp_CreateDefaultConfig();
+	char section[LINE_LENGTH];
+
+	gProcessors = processors;
+	gProcessorCalls = 0;
+
+	ORP_HANDLE hIni = rp_IniOpenBuffer(gText, gTextLength, &config);
+	ORP_ERR r = rpGetLastError();
+
+	snprintf(desc, DESC_LENGTH, "%s", rpGetLastErrorDesc() ? rpGetLastErrorDesc() : "");
+	memset(sum, 0, sizeof(S_KeySum));
+
+	for(unsigned int i = 0; hIni && i < NUM_LINES; i += KEYS_PER_SECTION + 1)
+	{
+		snprintf(section, LINE_LENGTH, "Section%u", i);
+		if(rp_IniEnumerateKeys(hIni, section, SumKey, sum) != ORP_ERR_NO_ERROR)
+			r = rpGetLastError();
+	}
+
+	if(hIni)
+		rpFreeHandle(hIni);
+
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckErrors(const char *newLine, const unsigned int *badLines, unsigned int numBadLines)
+{
+	// the first bad line is reported, whichever chunk it's in
+	char serialDesc[DESC_LENGTH], parallelDesc[DESC_LENGTH], expected[32];
+	S_KeySum serialSum, parallelSum;
+	unsigned int firstBad = badLines[0];
+
+	for(unsigned int b = 1; b < numBadLines; b++)
+		firstBad = badLines[b] < firstBad ? badLines[b] : firstBad;
+
+	GenerateIni(newLine, badLines, numBadLines);
+
+	ORP_ERR serial = Parse(1, serialDesc, &serialSum);
+	ORP_ERR parallel = Parse(NUM_CHUNKS, parallelDesc, &parallelSum);
+	bool split = gProcessorCalls > 0;
+
+	snprintf(expected, sizeof(expected), " Line: %u.", firstBad + 1);
+
+	bool same = split && serial != ORP_ERR_NO_ERROR && serial == parallel && strcmp(serialDesc, parallelDesc) == 0 &&
+		strstr(parallelDesc, expected) != NULL;
+
+	if(!same)
+		printf("line %u: serial %d \"%s\", parallel %d \"%s\"%s\n", firstBad + 1, (int)serial, serialDesc, (int)parallel, parallelDesc,
+			split ? "" : ", the file wasn't split");
+
+	return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	static const char *newLines[] = { "\n", "\r\n" };
+	char what[128];
+
+	gText = malloc(NUM_LINES * LINE_LENGTH);
+	if(!gText)
+	{
+		printf("Out of memory\n");
+		return 1;
+	}
+
+	for(unsigned int n = 0; n < sizeof(newLines) / sizeof(newLines[0]); n++)
+	{
+		const char *name = n == 0 ? "LF" : "CRLF";
+		char desc[DESC_LENGTH];
+		S_KeySum serialSum, parallelSum;
+
+		GenerateIni(newLines[n], NULL, 0);
+
+		ORP_ERR serial = Parse(1, desc, &serialSum);
+		ORP_ERR parallel = Parse(NUM_CHUNKS, desc, &parallelSum);
+
+		snprintf(what, sizeof(what), "%s: a split parse finds the same keys as a whole one", name);
+		Check(gProcessorCalls > 0 && serial == ORP_ERR_NO_ERROR && parallel == ORP_ERR_NO_ERROR && serialSum.NumKeys == parallelSum.NumKeys &&
+			serialSum.Hash == parallelSum.Hash && serialSum.NumKeys == NUM_LINES - (NUM_LINES + KEYS_PER_SECTION) / (KEYS_PER_SECTION + 1), what);
+
+		bool same = true;
+		unsigned int lines[] = { 0, 1, NUM_LINES / 2 + 3, NUM_LINES - 1 };
+
+		for(unsigned int i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+			same = CheckErrors(newLines[n], &lines[i], 1) && same;
+
+		snprintf(what, sizeof(what), "%s: errors in the first, middle and last lines have their line in the file", name);
+		Check(same, what);
+
+		// the section headers the file is split at, alone and after an error in an earlier chunk
+		same = true;
+		for(unsigned int c = 1; c < NUM_CHUNKS; c++)
+		{
+			unsigned int header = SectionLineAfter(gTextLength / NUM_CHUNKS * c);
+			unsigned int pair[] = { header, header - KEYS_PER_SECTION * c };
+
+			same = CheckErrors(newLines[n], &header, 1) && same;
+			same = CheckErrors(newLines[n], pair, 2) && same;
+		}
+
+		snprintf(what, sizeof(what), "%s: errors on the headers the file is split at have their line in the file", name);
+		Check(same, what);
+	}
+
+	free(gText);
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
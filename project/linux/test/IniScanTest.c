@@ -0,0 +1,428 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Equivalence test for the SIMD and scalar scanners of lib/src/util/Scan.c. Random
+// buffers are scanned from every offset, and generated INIs, some of them broken,
+// are parsed with both; sections, keys, values and errors must be the same.
+//
+// Built and run by "make test". It's linked with the scanners wrapped and with a
+// copy of Scan.c built with ORP_SCAN_SCALAR, so each parse can pick either one.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_BUFFERS 2000
+#define BUFFER_LENGTH 160
+#define NUM_INIS 400
+#define INI_LENGTH (64 * 1024)
+#define NUM_NAMES 6
+#define NAME_LENGTH 32
+#define PATH_LENGTH 64
+
+typedef struct S_Record_t
+{
+	char *Text;
+	size_t Length;
+	size_t Capacity;
+}S_Record;
+
+static bool gScalar;
+static unsigned int gFailures;
+static uint64_t gRandom = 0x9E3779B97F4A7C15ull;
+static char gPath[PATH_LENGTH];
+
+// bytes the scanners treat differently, weighted towards the ones INIs are made of
+static const unsigned char gAlphabet[] = "abcXYZ019 =];[\r\n \t\x01\x7F\x80\xFF";
+
+size_t __real_rp_ScanToCharOrControl(const unsigned char *data, size_t length, unsigned char c);
+size_t __real_rp_ScanToNewLine(const unsigned char *data, size_t length);
+size_t __real_rp_ScanToNonSpace(const unsigned char *data, size_t length);
+
+size_t rp_ScalarScanToCharOrControl(const unsigned char *data, size_t length, unsigned char c);
+size_t rp_ScalarScanToNewLine(const unsigned char *data, size_t length);
+size_t rp_ScalarScanToNonSpace(const unsigned char *data, size_t length);
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t __wrap_rp_ScanToCharOrControl(const unsigned char *data, size_t length, unsigned char c)
+{
+	return gScalar ? rp_ScalarScanToCharOrControl(data, length, c) : __real_rp_ScanToCharOrControl(data, length, c);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t __wrap_rp_ScanToNewLine(const unsigned char *data, size_t length)
+{
+	return gScalar ? rp_ScalarScanToNewLine(data, length) : __real_rp_ScanToNewLine(data, length);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t __wrap_rp_ScanToNonSpace(const unsigned char *data, size_t length)
+{
+	return gScalar ? rp_ScalarScanToNonSpace(data, length) : __real_rp_ScanToNonSpace(data, length);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t Random(void)
+{
+	// xorshift64*, every run tests the same data
+	gRandom ^= gRandom >> 12;
+	gRandom ^= gRandom << 25;
+	gRandom ^= gRandom >> 27;
+
+	return (uint32_t)((gRandom * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+unsigned char RandomByte(void)
+{
+	return gAlphabet[Random() % (sizeof(gAlphabet) - 1)];
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckKernels(void)
+{
+	// every start offset, so the vector loops run misaligned and hand different tails to the scalar loop
+	unsigned char data[BUFFER_LENGTH];
+	bool same = true;
+
+	for(unsigned int n = 0; n < NUM_BUFFERS && same; n++)
+	{
+		size_t length = Random() % BUFFER_LENGTH;
+		for(size_t i = 0; i < length; i++)
+			data[i] = RandomByte();
+
+		for(size_t start = 0; start <= length && same; start++)
+		{
+			const unsigned char *p = data + start;
+			size_t rest = length - start;
+
+			same = __real_rp_ScanToNewLine(p, rest) == rp_ScalarScanToNewLine(p, rest) &&
+				__real_rp_ScanToNonSpace(p, rest) == rp_ScalarScanToNonSpace(p, rest) &&
+				__real_rp_ScanToCharOrControl(p, rest, '=') == rp_ScalarScanToCharOrControl(p, rest, '=') &&
+				__real_rp_ScanToCharOrControl(p, rest, ']') == rp_ScalarScanToCharOrControl(p, rest, ']');
+
+			if(!same)
+				printf("scanners differ on buffer %u from offset %zu\n", n, start);
+		}
+	}
+
+	return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Append(S_Record *record, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if(record->Length + (size_t)length + 1 > record->Capacity)
+	{
+		record->Capacity = (record->Length + (size_t)length + 1) * 2;
+		record->Text = realloc(record->Text, record->Capacity);
+	}
+
+	if(record->Text)
+	{
+		va_start(args, format);
+		record->Length += (size_t)vsnprintf(record->Text + record->Length, record->Capacity - record->Length, format, args);
+		va_end(args);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void AppendChar(S_Record *record, char c)
+{
+	if(record->Length + 2 > record->Capacity)
+	{
+		record->Capacity = (record->Length + 2) * 2;
+		record->Text = realloc(record->Text, record->Capacity);
+	}
+
+	if(record->Text)
+	{
+		record->Text[record->Length++] = c;
+		record->Text[record->Length] = 0;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void AppendView(S_Record *record, const char *view, size_t length)
+{
+	// bytes outside 32-126 are escaped so they show up in the comparison
+	for(size_t i = 0; i < length; i++)
+	{
+		unsigned char c = (unsigned char)view[i];
+
+		if(c >= 32 && c <= 126 && c != '\\')
+			AppendChar(record, (char)c);
+		else
+			Append(record, "\\x%02X", c);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool RecordSection(const char *section, size_t sectionLength, void *userPtr)
+{
+	Append(userPtr, "[");
+	AppendView(userPtr, section, sectionLength);
+	Append(userPtr, "]\n");
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool RecordKey(const char *key, size_t keyLength, const char *value, size_t valueLength, void *userPtr)
+{
+	AppendView(userPtr, key, keyLength);
+	Append(userPtr, "=");
+	AppendView(userPtr, value, valueLength);
+	Append(userPtr, "\n");
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool RecordEnumKey(const char *key, const char *value, void *userPtr)
+{
+	return RecordKey(key, strlen(key), value, strlen(value), userPtr);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void RecordError(S_Record *record, ORP_ERR r)
+{
+	const char *desc = rpGetLastErrorDesc();
+	Append(record, "error %d %s\n", (int)r, desc ? desc : "");
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void AppendRandom(S_Record *ini, unsigned int maxLength)
+{
+	unsigned int length = Random() % maxLength;
+
+	for(unsigned int i = 0; i < length; i++)
+	{
+		// mostly text with the occasional separator, so lines run across several vector blocks
+		unsigned int pick = Random() % 16;
+		AppendChar(ini, pick < 12 ? (char)('a' + pick) : pick < 15 ? ' ' : "=];"[Random() % 3]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void GenerateIni(S_Record *ini, bool broken)
+{
+	static const char *newLines[] = { "\n", "\r\n", "\r" };
+	unsigned int numLines = 20 + Random() % 200;
+
+	for(unsigned int line = 0; line < numLines && ini->Length < INI_LENGTH; line++)
+	{
+		unsigned int kind = line == 0 ? 0 : Random() % 8;
+
+		AppendRandom(ini, Random() % 4 == 0 ? 4 : 1); // leading spaces now and then
+
+		if(kind == 0)
+			Append(ini, "[Section%u]", Random() % NUM_NAMES);
+		else if(kind == 1)
+		{
+			Append(ini, ";");
+			AppendRandom(ini, 80);
+		}
+		else if(kind == 2)
+			; // blank line
+		else
+		{
+			Append(ini, "Key%u", Random() % NUM_NAMES);
+			AppendRandom(ini, 3);
+			Append(ini, "=");
+			AppendRandom(ini, 100);
+		}
+
+		Append(ini, "%s", newLines[Random() % 3]);
+	}
+
+	// a byte the tokenizer rejects, or a key line without a value
+	if(broken && ini->Text)
+	{
+		if(Random() % 2)
+			ini->Text[Random() % ini->Length] = "\x01\x7F\x80\xFF\t"[Random() % 5];
+		else
+			Append(ini, "Key\n");
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void ParseIni(S_Record *ini, S_Record *record)
+{
+	// a stream parse reports every token, an opened INI the keys that won over their duplicates
+	S_IniConfig config = rp_CreateDefaultConfig();
+	char name[NAME_LENGTH];
+
+	for(int trim = 0; trim < 2; trim++)
+	{
+		config.TrimKeyValues = trim != 0;
+
+		RecordError(record, rp_IniParseStream(gPath, &config, RecordSection, RecordKey, record));
+
+		ORP_HANDLE hIni = rp_IniOpenBuffer(ini->Text, ini->Length, &config);
+		RecordError(record, rpGetLastError());
+
+		for(unsigned int i = 0; hIni && i < NUM_NAMES; i++)
+		{
+			snprintf(name, NAME_LENGTH, "Section%u", i);
+
+			Append(record, "enumerate %s\n", name);
+			RecordError(record, rp_IniEnumerateKeys(hIni, name, RecordEnumKey, record));
+		}
+
+		if(hIni)
+			rpFreeHandle(hIni);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckInis(void)
+{
+	S_Record ini = { 0 }, simd = { 0 }, scalar = { 0 };
+	unsigned int numErrors = 0;
+	bool same = true;
+
+	for(unsigned int n = 0; n < NUM_INIS && same; n++)
+	{
+		ini.Length = simd.Length = scalar.Length = 0;
+		GenerateIni(&ini, n % 4 == 3);
+
+		FILE *f = fopen(gPath, "wb");
+		bool written = f && ini.Text && fwrite(ini.Text, 1, ini.Length, f) == ini.Length;
+
+		if(f && fclose(f) != 0)
+			written = false;
+
+		if(!written)
+		{
+			printf("Can't write %s\n", gPath);
+			return false;
+		}
+
+		gScalar = false;
+		ParseIni(&ini, &simd);
+		gScalar = true;
+		ParseIni(&ini, &scalar);
+		gScalar = false;
+
+		same = simd.Text && scalar.Text && simd.Length == scalar.Length && memcmp(simd.Text, scalar.Text, simd.Length) == 0;
+		numErrors += simd.Text && strstr(simd.Text, " Line: ") != NULL;
+
+		if(!same)
+			printf("parses of INI %u differ, SIMD:\n%s\nscalar:\n%s\n", n, simd.Text, scalar.Text);
+	}
+
+	// make sure the broken INIs did fail, otherwise the error paths went untested
+	if(same && numErrors == 0)
+	{
+		printf("no INI failed to parse\n");
+		same = false;
+	}
+
+	free(ini.Text);
+	free(simd.Text);
+	free(scalar.Text);
+
+	return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	snprintf(gPath, PATH_LENGTH, "/tmp/IniScanTest.XXXXXX");
+
+	int fd = mkstemp(gPath);
+	if(fd < 0)
+	{
+		printf("Can't create a scratch file\n");
+		return 1;
+	}
+
+	close(fd);
+
+	Check(CheckKernels(), "SIMD and scalar scanners stop at the same byte");
+	Check(CheckInis(), "SIMD and scalar scanners parse INIs the same, errors and line numbers included");
+
+	remove(gPath);
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
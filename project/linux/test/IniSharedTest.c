@@ -0,0 +1,304 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Concurrency test for shared INIs. Threads open, read and free handles to the
+// same two files at once, so the shared INIs are acquired, parsed, released and
+// freed while other threads look keys up and parse typed values in them.
+//
+// Built and run by "make test". "make tsan" builds it with ThreadSanitizer and
+// runs it again, any data race it reports fails the run.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/platform/Platform.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUM_THREADS 8
+#define NUM_ROUNDS 100
+#define NUM_LOOKUPS 40
+#define NUM_SECTIONS 40
+#define NUM_KEYS 16
+#define NUM_FILES 2
+#define NAME_LENGTH 32
+#define PATH_LENGTH 64
+
+typedef struct S_Worker_t
+{
+	unsigned int Index;
+	uint64_t Random;
+	unsigned int Failures;
+	unsigned int Opens;
+}S_Worker;
+
+static unsigned int gFailures;
+static char gPaths[NUM_FILES][PATH_LENGTH];
+static char gSnapshotPaths[NUM_FILES][PATH_LENGTH + 8];
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t Random(S_Worker *worker)
+{
+	// xorshift64*, one state per thread
+	worker->Random ^= worker->Random >> 12;
+	worker->Random ^= worker->Random << 25;
+	worker->Random ^= worker->Random >> 27;
+
+	return (uint32_t)((worker->Random * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int KeyValue(unsigned int file, unsigned int section, unsigned int key)
+{
+	return (int)(file * 100000 + section * 100 + key);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool WriteIni(unsigned int file)
+{
+	// every section has int keys and a list of the same ints
+	FILE *f = fopen(gPaths[file], "wb");
+	bool written = f != NULL;
+
+	for(unsigned int s = 0; s < NUM_SECTIONS && written; s++)
+	{
+		written = fprintf(f, "[Section%u]\nList=", s) > 0;
+
+		for(unsigned int k = 0; k < NUM_KEYS && written; k++)
+			written = fprintf(f, k ? ", %d" : "%d", KeyValue(file, s, k)) > 0;
+
+		for(unsigned int k = 0; k < NUM_KEYS && written; k++)
+			written = fprintf(f, "\nKey%u=%d", k, KeyValue(file, s, k)) > 0;
+
+		written = written && fprintf(f, "\n") > 0;
+	}
+
+	if(f && fclose(f) != 0)
+		written = false;
+
+	return written;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CountKey(const char *key, const char *value, void *userPtr)
+{
+	(*(unsigned int *)userPtr)++;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool Lookup(ORP_HANDLE hIni, unsigned int file, S_Worker *worker)
+{
+	// one random section, read the way each kind of consumer would
+	char section[NAME_LENGTH], key[NAME_LENGTH];
+	unsigned int s = Random(worker) % NUM_SECTIONS, k = Random(worker) % NUM_KEYS;
+	int expected = KeyValue(file, s, k);
+
+	snprintf(section, NAME_LENGTH, "Section%u", s);
+	snprintf(key, NAME_LENGTH, "Key%u", k);
+
+	const char *view = NULL;
+	size_t length = 0;
+	char text[NAME_LENGTH];
+	snprintf(text, NAME_LENGTH, "%d", expected);
+
+	if(rp_IniGetKeyView(hIni, section, key, &view, &length) != ORP_ERR_NO_ERROR || length != strlen(text) || memcmp(view, text, length) != 0)
+		return false;
+
+	int value = 0;
+	if(rp_IniReadInt(hIni, section, key, &value) != ORP_ERR_NO_ERROR || value != expected)
+		return false;
+
+	const int *values = NULL;
+	size_t count = 0;
+	if(rp_IniReadIntList(hIni, section, "List", &values, &count) != ORP_ERR_NO_ERROR || count != NUM_KEYS || values[k] != expected)
+		return false;
+
+	const char *const *strings = NULL;
+	if(rp_IniReadStringList(hIni, section, "List", &strings, &count) != ORP_ERR_NO_ERROR || count != NUM_KEYS || strcmp(strings[k], text) != 0)
+		return false;
+
+	unsigned int numKeys = 0;
+	return rp_IniEnumerateKeys(hIni, section, CountKey, &numKeys) == ORP_ERR_NO_ERROR && numKeys == NUM_KEYS + 1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Worker(void *userPtr)
+{
+	// a handle is sometimes kept for a round, so INIs are released both while other
+	// handles hold them and by their last handle
+	S_Worker *worker = userPtr;
+	ORP_HANDLE hKept = NULL;
+
+	for(unsigned int round = 0; round < NUM_ROUNDS; round++)
+	{
+		unsigned int file = Random(worker) % NUM_FILES;
+		S_IniConfig config = rp_CreateDefaultConfig();
+		config.Shared = true;
+		config.Snapshot = (worker->Index + round) % 3 == 0;
+
+		ORP_HANDLE hIni = rp_IniOpen(gPaths[file], &config);
+
+		if(!hIni)
+			worker->Failures++;
+		else
+		{
+			worker->Opens++;
+
+			for(unsigned int i = 0; i < NUM_LOOKUPS; i++)
+			{
+				if(!Lookup(hIni, file, worker))
+					worker->Failures++;
+			}
+		}
+
+		if(hKept)
+			rpFreeHandle(hKept);
+
+		hKept = NULL;
+		if(hIni && Random(worker) % 2)
+			hKept = hIni;
+		else if(hIni)
+			rpFreeHandle(hIni);
+	}
+
+	if(hKept)
+		rpFreeHandle(hKept);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckSharing(void)
+{
+	// handles to one shared INI see the same storage, other parse options get an INI of their own
+	S_IniConfig config = rp_CreateDefaultConfig();
+	config.Shared = true;
+
+	ORP_HANDLE hFirst = rp_IniOpen(gPaths[0], &config);
+	ORP_HANDLE hSecond = rp_IniOpen(gPaths[0], &config);
+
+	config.KeysCaseInsensitive = !config.KeysCaseInsensitive;
+	ORP_HANDLE hOther = rp_IniOpen(gPaths[0], &config);
+
+	const char *first = NULL, *second = NULL, *other = NULL;
+	size_t length;
+
+	bool shared = hFirst && hSecond && hOther &&
+		rp_IniGetKeyView(hFirst, "Section0", "Key0", &first, &length) == ORP_ERR_NO_ERROR &&
+		rp_IniGetKeyView(hSecond, "Section0", "Key0", &second, &length) == ORP_ERR_NO_ERROR &&
+		rp_IniGetKeyView(hOther, "Section0", "Key0", &other, &length) == ORP_ERR_NO_ERROR &&
+		first == second && first != other;
+
+	if(hFirst)
+		rpFreeHandle(hFirst);
+	if(hSecond)
+		rpFreeHandle(hSecond);
+	if(hOther)
+		rpFreeHandle(hOther);
+
+	return shared;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	S_Worker workers[NUM_THREADS];
+	ORP_HANDLE hThreads[NUM_THREADS];
+	char what[128];
+
+	for(unsigned int f = 0; f < NUM_FILES; f++)
+	{
+		snprintf(gPaths[f], PATH_LENGTH, "/tmp/IniSharedTest.XXXXXX");
+
+		int fd = mkstemp(gPaths[f]);
+		if(fd < 0)
+		{
+			printf("Can't create a scratch file\n");
+			return 1;
+		}
+
+		close(fd);
+		snprintf(gSnapshotPaths[f], sizeof(gSnapshotPaths[f]), "%s.snap", gPaths[f]);
+
+		if(!WriteIni(f))
+		{
+			printf("Can't write %s\n", gPaths[f]);
+			return 1;
+		}
+	}
+
+	Check(CheckSharing(), "handles to the same file share one INI per parse options");
+
+	unsigned int numThreads = 0;
+	for(unsigned int i = 0; i < NUM_THREADS; i++)
+	{
+		workers[i].Index = i;
+		workers[i].Random = 0x9E3779B97F4A7C15ull * (i + 1);
+		workers[i].Failures = 0;
+		workers[i].Opens = 0;
+
+		if((hThreads[i] = rp_CreateThread(Worker, &workers[i])) != NULL)
+			numThreads++;
+	}
+
+	unsigned int failures = 0, opens = 0;
+	for(unsigned int i = 0; i < NUM_THREADS; i++)
+	{
+		if(hThreads[i])
+			rpFreeHandle(hThreads[i]);
+
+		failures += workers[i].Failures;
+		opens += workers[i].Opens;
+	}
+
+	snprintf(what, sizeof(what), "%u threads opened shared INIs %u times, every read returned the value in the file", numThreads, opens);
+	Check(numThreads == NUM_THREADS && opens == NUM_THREADS * NUM_ROUNDS && failures == 0, what);
+
+	for(unsigned int f = 0; f < NUM_FILES; f++)
+	{
+		remove(gSnapshotPaths[f]);
+		remove(gPaths[f]);
+	}
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}
@@ -0,0 +1,441 @@
+//------------------------------------------------------------------------------
+//  This Source Code Form is subject to the terms of the Mozilla Public
+//  License, v. 2.0. If a copy of the MPL was not distributed with this
+//  file, You can obtain one at http://mozilla.org/MPL/2.0/.
+//------------------------------------------------------------------------------
+// Equivalence test for the typed value cache of lib/src/util/Ini.c. Every key of
+// the generated INIs is read as an int, a bool, an int list and a string list in
+// random order and more than once, and each result is compared with parsing the
+// value directly. Repeated reads must return the cached arrays.
+//
+// Built and run by "make test", each INI is opened from a buffer, lazily, from a
+// snapshot and shared.
+//------------------------------------------------------------------------------
+#include "OpenRP1210/OpenRP1210.h"
+#include "OpenRP1210/util/Ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define NUM_INIS 20
+#define NUM_SECTIONS 8
+#define NUM_KEYS 24
+#define NUM_READS 8
+#define MAX_ITEMS 4
+#define NAME_LENGTH 32
+#define VALUE_LENGTH 128
+#define PATH_LENGTH 64
+#define TEXT_LENGTH (NUM_SECTIONS * NUM_KEYS * (NAME_LENGTH + VALUE_LENGTH))
+#define MAX_REPORTS 5
+
+typedef enum E_OpenMode_t
+{
+	OpenMode_Buffer,
+	OpenMode_Lazy,
+	OpenMode_Snapshot,
+	OpenMode_Shared,
+	OpenMode_Count
+}E_OpenMode;
+
+typedef enum E_ReadType_t
+{
+	ReadType_Int,
+	ReadType_Bool,
+	ReadType_IntList,
+	ReadType_StringList,
+	ReadType_Count
+}E_ReadType;
+
+// what a read returned, lists point into the INI
+typedef struct S_ReadResult_t
+{
+	ORP_ERR Error;
+	int Int;
+	bool Bool;
+	const int *Ints;
+	const char *const *Strings;
+	size_t Count;
+}S_ReadResult;
+
+static const char *gModeNames[] = { "buffer", "lazy", "snapshot", "shared" };
+
+// list items, numbers in every base strtol reads, at and past the int range, booleans and words that are neither
+static const char *gItems[] =
+{
+	"0", "1", "-7", "42", "0x1F", "-0x10", "017", "08", "2147483647", "-2147483648", "2147483648", "-2147483649",
+	"99999999999999999999", "true", "Off", "YES", "no", "on", "FALSE", "abc", "1x", "1 2"
+};
+
+static const char *gSeparators[] = { ",", ", ", " ,", ",,", " , " };
+
+static unsigned int gFailures;
+static unsigned int gReports;
+static uint64_t gRandom = 0x9E3779B97F4A7C15ull;
+static char gPath[PATH_LENGTH];
+static char gSnapshotPath[PATH_LENGTH + 8];
+static char gValues[NUM_SECTIONS][NUM_KEYS][VALUE_LENGTH];
+static char gText[TEXT_LENGTH];
+static size_t gTextLength;
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void Check(bool passed, const char *what)
+{
+	printf("%s %s\n", passed ? "PASS" : "FAIL", what);
+
+	if(!passed)
+		gFailures++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+uint32_t Random(void)
+{
+	// xorshift64*, every run tests the same INIs
+	gRandom ^= gRandom >> 12;
+	gRandom ^= gRandom << 25;
+	gRandom ^= gRandom >> 27;
+
+	return (uint32_t)((gRandom * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+void GenerateIni(void)
+{
+	// one item makes an int or a bool, more make a list
+	gTextLength = 0;
+
+	for(unsigned int s = 0; s < NUM_SECTIONS; s++)
+	{
+		gTextLength += (size_t)snprintf(gText + gTextLength, TEXT_LENGTH - gTextLength, "[Section%u]\n", s);
+
+		for(unsigned int k = 0; k < NUM_KEYS; k++)
+		{
+			char *value = gValues[s][k];
+			unsigned int numItems = 1 + Random() % MAX_ITEMS;
+
+			snprintf(value, VALUE_LENGTH, "%s", gItems[Random() % (sizeof(gItems) / sizeof(gItems[0]))]);
+
+			for(unsigned int i = 1; i < numItems; i++)
+			{
+				size_t length = strlen(value);
+				snprintf(value + length, VALUE_LENGTH - length, "%s%s", gSeparators[Random() % (sizeof(gSeparators) / sizeof(gSeparators[0]))],
+					gItems[Random() % (sizeof(gItems) / sizeof(gItems[0]))]);
+			}
+
+			gTextLength += (size_t)snprintf(gText + gTextLength, TEXT_LENGTH - gTextLength, "Key%u=%s\n", k, value);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR RefParseInt(const char *str, int *value)
+{
+	char *e = NULL;
+
+	errno = 0;
+	long v = strtol(str, &e, 0);
+
+	if(*e != 0)
+		return ORP_ERR_BAD_ARG;
+	if(errno == ERANGE || v > INT_MAX || v < INT_MIN)
+		return ORP_ERR_BAD_RANGE;
+
+	*value = (int)v;
+	return ORP_ERR_NO_ERROR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_ERR RefParseBool(const char *str, bool *value)
+{
+	static const char *trueNames[] = { "1", "true", "yes", "on" };
+	static const char *falseNames[] = { "0", "false", "no", "off" };
+
+	for(unsigned int i = 0; i < sizeof(trueNames) / sizeof(trueNames[0]); i++)
+	{
+		if(strcasecmp(str, trueNames[i]) == 0 || strcasecmp(str, falseNames[i]) == 0)
+		{
+			*value = strcasecmp(str, trueNames[i]) == 0;
+			return ORP_ERR_NO_ERROR;
+		}
+	}
+
+	return ORP_ERR_BAD_ARG;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+size_t RefSplitList(const char *value, char items[][VALUE_LENGTH])
+{
+	// comma separated, spaces around items and empty items are dropped
+	size_t count = 0;
+
+	for(const char *item = value; item; )
+	{
+		const char *comma = strchr(item, ',');
+		const char *end = comma ? comma : item + strlen(item);
+
+		while(item < end && *item == ' ')
+			item++;
+		while(end > item && end[-1] == ' ')
+			end--;
+
+		if(item < end)
+			snprintf(items[count++], VALUE_LENGTH, "%.*s", (int)(end - item), item);
+
+		item = comma ? comma + 1 : NULL;
+	}
+
+	return count;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool Report(const char *mode, unsigned int section, unsigned int key, E_ReadType type, const char *what)
+{
+	static const char *typeNames[] = { "int", "bool", "int list", "string list" };
+
+	if(gReports++ < MAX_REPORTS)
+		printf("%s: Section%u Key%u=%s read as %s: %s\n", mode, section, key, gValues[section][key], typeNames[type], what);
+
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+S_ReadResult Read(ORP_HANDLE hIni, const char *section, const char *key, E_ReadType type)
+{
+	S_ReadResult result;
+	memset(&result, 0, sizeof(result));
+
+	if(type == ReadType_Int)
+		result.Error = rp_IniReadInt(hIni, section, key, &result.Int);
+	else if(type == ReadType_Bool)
+		result.Error = rp_IniReadBool(hIni, section, key, &result.Bool);
+	else if(type == ReadType_IntList)
+		result.Error = rp_IniReadIntList(hIni, section, key, &result.Ints, &result.Count);
+	else
+		result.Error = rp_IniReadStringList(hIni, section, key, &result.Strings, &result.Count);
+
+	return result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckRead(S_ReadResult *result, const char *value, E_ReadType type)
+{
+	char items[MAX_ITEMS][VALUE_LENGTH];
+	S_ReadResult expected;
+	memset(&expected, 0, sizeof(expected));
+
+	if(type == ReadType_Int)
+		return (expected.Error = RefParseInt(value, &expected.Int)) == result->Error && (expected.Error != ORP_ERR_NO_ERROR || expected.Int == result->Int);
+	else if(type == ReadType_Bool)
+		return (expected.Error = RefParseBool(value, &expected.Bool)) == result->Error && (expected.Error != ORP_ERR_NO_ERROR || expected.Bool == result->Bool);
+
+	expected.Count = RefSplitList(value, items);
+
+	if(type == ReadType_StringList)
+	{
+		bool same = result->Error == ORP_ERR_NO_ERROR && result->Count == expected.Count;
+
+		for(size_t i = 0; i < expected.Count && same; i++)
+			same = strcmp(result->Strings[i], items[i]) == 0;
+
+		return same;
+	}
+
+	// the first item that isn't an int fails the whole list
+	bool same = true;
+	int item = 0;
+
+	for(size_t i = 0; i < expected.Count && expected.Error == ORP_ERR_NO_ERROR; i++)
+	{
+		expected.Error = RefParseInt(items[i], &item);
+		same = expected.Error != ORP_ERR_NO_ERROR || (result->Ints && i < result->Count && result->Ints[i] == item);
+	}
+
+	return same && result->Error == expected.Error && (expected.Error != ORP_ERR_NO_ERROR || result->Count == expected.Count);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool CheckReads(ORP_HANDLE hIni, const char *mode)
+{
+	char section[NAME_LENGTH], key[NAME_LENGTH];
+	bool same = true;
+
+	for(unsigned int s = 0; s < NUM_SECTIONS; s++)
+	{
+		snprintf(section, NAME_LENGTH, "Section%u", s);
+
+		for(unsigned int k = 0; k < NUM_KEYS; k++)
+		{
+			S_ReadResult first[ReadType_Count];
+			bool read[ReadType_Count] = { false };
+
+			snprintf(key, NAME_LENGTH, "Key%u", k);
+
+			for(unsigned int n = 0; n < NUM_READS; n++)
+			{
+				E_ReadType type = (E_ReadType)(Random() % ReadType_Count);
+				S_ReadResult result = Read(hIni, section, key, type);
+
+				if(!CheckRead(&result, gValues[s][k], type))
+					same = Report(mode, s, k, type, "differs from parsing the value");
+				else if(read[type] && (result.Error != first[type].Error || result.Ints != first[type].Ints || result.Strings != first[type].Strings))
+					same = Report(mode, s, k, type, "a repeated read doesn't return the first result");
+
+				if(!read[type])
+				{
+					first[type] = result;
+					read[type] = true;
+				}
+			}
+		}
+	}
+
+	return same;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+ORP_HANDLE OpenIni(E_OpenMode mode)
+{
+	S_IniConfig config = rp_CreateDefaultConfig();
+	ORP_HANDLE hIni = NULL;
+
+	if(mode == OpenMode_Buffer || mode == OpenMode_Lazy)
+	{
+		config.LazySections = mode == OpenMode_Lazy;
+		hIni = rp_IniOpenBuffer(gText, gTextLength, &config);
+	}
+	else if(mode == OpenMode_Snapshot)
+	{
+		// the first open parses and saves the snapshot, the second one loads it
+		config.Snapshot = true;
+		remove(gSnapshotPath);
+
+		hIni = rp_IniOpen(gPath, &config);
+		if(hIni)
+			rpFreeHandle(hIni);
+
+		hIni = access(gSnapshotPath, F_OK) == 0 ? rp_IniOpen(gPath, &config) : NULL;
+	}
+	else
+	{
+		config.Shared = true;
+		hIni = rp_IniOpen(gPath, &config);
+	}
+
+	return hIni;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+bool WriteIni(void)
+{
+	FILE *f = fopen(gPath, "wb");
+	bool written = f && fwrite(gText, 1, gTextLength, f) == gTextLength;
+
+	if(f && fclose(f) != 0)
+		written = false;
+
+	return written;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+///
+///
+/////////////////////////////////////////////////////////////////////////////////
+int main(void)
+{
+	bool same[OpenMode_Count];
+	char what[128];
+
+	snprintf(gPath, PATH_LENGTH, "/tmp/IniTypedTest.XXXXXX");
+
+	int fd = mkstemp(gPath);
+	if(fd < 0)
+	{
+		printf("Can't create a scratch file\n");
+		return 1;
+	}
+
+	close(fd);
+	snprintf(gSnapshotPath, sizeof(gSnapshotPath), "%s.snap", gPath);
+	memset(same, true, sizeof(same));
+
+	for(unsigned int n = 0; n < NUM_INIS; n++)
+	{
+		GenerateIni();
+
+		if(!WriteIni())
+		{
+			printf("Can't write %s\n", gPath);
+			return 1;
+		}
+
+		for(unsigned int mode = 0; mode < OpenMode_Count; mode++)
+		{
+			ORP_HANDLE hIni = OpenIni((E_OpenMode)mode);
+
+			if(!hIni)
+			{
+				printf("%s: can't open the INI\n", gModeNames[mode]);
+				same[mode] = false;
+			}
+			else
+			{
+				if(!CheckReads(hIni, gModeNames[mode]))
+					same[mode] = false;
+
+				rpFreeHandle(hIni);
+			}
+		}
+	}
+
+	for(unsigned int mode = 0; mode < OpenMode_Count; mode++)
+	{
+		snprintf(what, sizeof(what), "%s: typed reads match parsing the value, repeated reads return the cached result", gModeNames[mode]);
+		Check(same[mode], what);
+	}
+
+	remove(gSnapshotPath);
+	remove(gPath);
+
+	printf("\n%u failed\n", gFailures);
+	return gFailures ? 1 : 0;
+}